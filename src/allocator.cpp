@@ -2,8 +2,160 @@
 #include "memory.h"
 
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <memory>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace vm {
+
+#ifdef _WIN32
+void* reserve(size_t size) {
+    return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+bool commit(void* start, size_t size) {
+    return VirtualAlloc(start, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+}
+
+void release(void* start, size_t size) {
+    VirtualFree(start, 0, MEM_RELEASE);
+}
+#else
+void* reserve(size_t size) {
+    void* start = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return start == MAP_FAILED ? nullptr : start;
+}
+
+bool commit(void* start, size_t size) {
+    return mprotect(start, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+void release(void* start, size_t size) {
+    munmap(start, size);
+}
+#endif
+
+} // namespace vm
+
+void arena_overflow(size_t requested, size_t capacity) {
+    std::fprintf(stderr, "arena overflow, needed %zu bytes of %zu\n", requested, capacity);
+    std::abort();
+}
+
+linear_allocator& scratch_arena() {
+    thread_local linear_allocator arena;
+    if (arena.m_start == nullptr) {
+        arena.reserve(scratch_arena_size);
+    }
+
+    return arena;
+}
+
+free_list_allocator::~free_list_allocator() {
+    while (m_slabs != nullptr) {
+        Slab* next = m_slabs->next;
+        mem::charge(m_tag, -(int64_t)pool_slab_size);
+        free(m_slabs);
+        m_slabs = next;
+    }
+}
+
+int free_list_allocator::size_class(size_t size) {
+    for (int i = 0; i < pool_class_count; i++) {
+        if (size <= pool_size_classes[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void free_list_allocator::refill(int pool_index) {
+    ZoneScoped;
+
+    auto slab = (Slab*)malloc(pool_slab_size);
+    if (slab == nullptr) {
+        arena_overflow(pool_slab_size, 0);
+    }
+    slab->next = m_slabs;
+    m_slabs = slab;
+    mem::charge(m_tag, (int64_t)pool_slab_size);
+
+    const size_t block_size = pool_size_classes[pool_index];
+    auto& pool = m_pools[pool_index];
+
+    std::byte* first = (std::byte*)slab + sizeof(Slab);
+    size_t count = (pool_slab_size - sizeof(Slab)) / block_size;
+
+    // push back to front so blocks come out in address order
+    for (size_t i = count; i-- > 0;) {
+        auto block = (FreeBlock*)(first + i * block_size);
+        block->next = pool.free;
+        pool.free = block;
+    }
+    pool.total_blocks += count;
+}
+
+void* free_list_allocator::allocate(size_t size, size_t alignment) {
+    int pool_index = size_class(size);
+    if (pool_index < 0 || alignment > pool_alignment) {
+        m_large_bytes += size;
+        mem::record_alloc(m_tag, size);
+        return ::operator new(size, std::align_val_t(alignment));
+    }
+
+    auto& pool = m_pools[pool_index];
+    if (pool.free == nullptr) {
+        refill(pool_index);
+    }
+
+    FreeBlock* block = pool.free;
+    pool.free = block->next;
+    pool.live_blocks++;
+    mem::count_allocation(m_tag);
+
+    return block;
+}
+
+void free_list_allocator::deallocate(void* ptr, size_t size, size_t alignment) {
+    if (ptr == nullptr) {
+        return;
+    }
+
+    int pool_index = size_class(size);
+    if (pool_index < 0 || alignment > pool_alignment) {
+        m_large_bytes -= size;
+        mem::record_free(m_tag, size);
+        ::operator delete(ptr, std::align_val_t(alignment));
+        return;
+    }
+
+    auto& pool = m_pools[pool_index];
+    auto block = (FreeBlock*)ptr;
+    block->next = pool.free;
+    pool.free = block;
+    pool.live_blocks--;
+}
+
+void free_list_allocator::plot_stats() {
+    static const char* live_names[] = {"pool 16 live", "pool 32 live", "pool 64 live", "pool 128 live", "pool 256 live", "pool 512 live", "pool 1024 live", "pool 2048 live"};
+    static const char* total_names[] = {"pool 16 total", "pool 32 total", "pool 64 total", "pool 128 total", "pool 256 total", "pool 512 total", "pool 1024 total", "pool 2048 total"};
+    static_assert(std::size(live_names) == pool_class_count && std::size(total_names) == pool_class_count);
+
+    for (int i = 0; i < pool_class_count; i++) {
+        TracyPlot(live_names[i], (int64_t)m_pools[i].live_blocks);
+        TracyPlot(total_names[i], (int64_t)m_pools[i].total_blocks);
+    }
+    TracyPlot("pool large bytes", (int64_t)m_large_bytes);
+}
+
 
 // template <typename T, class allocator> class stl_adaptor {
 //   public:
@@ -1,9 +1,16 @@
 #pragma once
 #include "EASTL/vector.h"
 #include "dev_macros.h"
+#include "mem_tags.h"
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <format>
+#include <iterator>
+#include <new>
+#include <type_traits>
 #include <tracy/Tracy.hpp>
 #include <vector>
 
@@ -65,7 +72,7 @@ struct alloc_ref {
     }
 
     void deallocate(void* ptr, size_t n) noexcept {
-        m_allocator->deallocate(ptr, n * sizeof(T));
+        m_allocator->deallocate(ptr, n * sizeof(T), alignof(T));
     }
 };
 
@@ -79,19 +86,62 @@ bool operator!=(const alloc_ref<T, Allocator>& a, const alloc_ref<U, Allocator>&
     return a.m_allocator != b.m_allocator;
 }
 
+// address space reservations, pages only get backed once committed
+namespace vm {
+void* reserve(size_t size);
+bool commit(void* start, size_t size);
+void release(void* start, size_t size);
+} // namespace vm
+
+// logs and aborts, overflowing an arena isnt something to limp on from even in release
+[[noreturn]] void arena_overflow(size_t requested, size_t capacity);
+
+// granularity linear_allocator commits reserved memory in
+constexpr size_t arena_commit_size = 64_KiB;
+
 struct linear_allocator {
-    void* m_start = nullptr;
-    uint32_t m_current{};
-    uint32_t m_capacity{};
+    std::byte* m_start = nullptr;
+    size_t m_current{};
+    size_t m_capacity{};
+    // bytes usable without committing more, all of it for a fixed buffer
+    size_t m_committed{};
+    // furthest m_current has been since init
+    size_t m_high_water{};
+    bool m_virtual{};
+    // committed pages are charged to this
+    MemTag m_tag{};
+
+    linear_allocator() = default;
+    linear_allocator(const linear_allocator&) = delete;
+    linear_allocator& operator=(const linear_allocator&) = delete;
+
+    ~linear_allocator() {
+        if (m_virtual) {
+            mem::charge(m_tag, -(int64_t)m_committed);
+            vm::release(m_start, m_capacity);
+        }
+    }
 
     void init(void* start, size_t size) {
-        m_start = start;
+        m_start = (std::byte*)start;
         m_capacity = size;
+        m_committed = size;
     }
 
     void init(const BufferHandle& buffer) {
-        m_start = buffer.data;
-        m_capacity = buffer.size;
+        init(buffer.data, buffer.size);
+    }
+
+    // reserves address space up front and commits it as the arena grows into it
+    void reserve(size_t size, MemTag tag = MemTag::general) {
+        m_start = (std::byte*)vm::reserve(size);
+        if (m_start == nullptr) {
+            arena_overflow(size, 0);
+        }
+        m_capacity = size;
+        m_committed = 0;
+        m_virtual = true;
+        m_tag = tag;
     }
 
     // ~monotonic_allocator() {
@@ -101,13 +151,34 @@ struct linear_allocator {
     void* allocate(size_t size, size_t alignment) {
         const auto aligned_size = (size + alignment - 1) & ~(alignment - 1);
         const auto aligned_current = (m_current + alignment - 1) & ~(alignment - 1);
+        const auto end = aligned_current + aligned_size;
 
-        m_current = aligned_current + aligned_size;
-        if (m_current > m_capacity) {
-            DEV_PANIC(std::format("allocating above capacity, current:{}, capacity:{}", m_current, m_capacity));
+        if (end > m_committed) {
+            grow(end);
         }
 
-        return (void*)((std::byte*)m_start + aligned_current);
+        m_current = end;
+        m_high_water = std::max(m_high_water, m_current);
+        mem::count_allocation(m_tag);
+
+        return m_start + aligned_current;
+    }
+
+    // grows ptr in place if its the last thing allocated, false if anything came after it
+    bool try_extend(void* ptr, size_t old_size, size_t new_size) {
+        const size_t offset = (std::byte*)ptr - m_start;
+        if (offset + old_size != m_current) {
+            return false;
+        }
+
+        const size_t end = offset + new_size;
+        if (end > m_committed) {
+            grow(end);
+        }
+
+        m_current = end;
+        m_high_water = std::max(m_high_water, m_current);
+        return true;
     }
 
     //return size also
@@ -115,11 +186,35 @@ struct linear_allocator {
         return BufferHandle{allocate(size, alignment), size};
     }
 
-    void deallocate(void* ptr, size_t size) {}
+    void deallocate(void* ptr, size_t size, size_t alignment = 0) {}
 
     void clear() {
         m_current = 0;
     }
+
+    size_t mark() const {
+        return m_current;
+    }
+
+    // frees everything allocated since mark
+    void rewind(size_t mark) {
+        m_current = mark;
+    }
+
+  private:
+    void grow(size_t end) {
+        if (!m_virtual || end > m_capacity) {
+            DEV_PANIC(std::format("allocating above capacity, current:{}, capacity:{}", end, m_capacity));
+            arena_overflow(end, m_capacity);
+        }
+
+        size_t committed = std::min(m_capacity, (end + arena_commit_size - 1) & ~(arena_commit_size - 1));
+        if (!vm::commit(m_start + m_committed, committed - m_committed)) {
+            arena_overflow(end, m_committed);
+        }
+        mem::charge(m_tag, (int64_t)(committed - m_committed));
+        m_committed = committed;
+    }
 };
 
 inline bool operator==(const linear_allocator& a, const linear_allocator& b) {
@@ -130,11 +225,73 @@ inline bool operator!=(const linear_allocator& a, const linear_allocator& b) {
     return a.m_start != b.m_start;
 }
 
-struct free_list_allocator {
-    void* current;
+// address space each thread's scratch arena reserves, only touched pages get committed
+constexpr size_t scratch_arena_size = 256_MiB;
+
+// per thread arena for temporaries that dont outlive the function using them
+// always allocate from it inside a ScratchScope, never hand it out past the scope
+linear_allocator& scratch_arena();
+
+// rewinds the calling thread's scratch arena on exit, nests like a stack
+// results that have to outlive a callee come from the caller's scope, pass scope.arena down
+struct ScratchScope {
+    linear_allocator& arena;
+    size_t m_mark;
+
+    ScratchScope() : arena(scratch_arena()), m_mark(arena.mark()) {}
+
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    ~ScratchScope() {
+        arena.rewind(m_mark);
+    }
+};
 
-    
+// size class pools with the free list threaded through the free blocks themselves
+// for long lived engine data, bigger or overaligned requests go to the global heap
+// not thread safe
+constexpr size_t pool_size_classes[] = {16, 32, 64, 128, 256, 512, 1024, 2048};
+constexpr int pool_class_count = std::size(pool_size_classes);
+constexpr size_t pool_slab_size = 64_KiB;
+constexpr size_t pool_alignment = 16;
 
+struct free_list_allocator {
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    // header at the start of every slab so they can be freed at the end
+    struct alignas(pool_alignment) Slab {
+        Slab* next;
+    };
+
+    struct Pool {
+        FreeBlock* free{};
+        size_t live_blocks{};
+        size_t total_blocks{};
+    };
+
+    std::array<Pool, pool_class_count> m_pools{};
+    Slab* m_slabs{};
+    size_t m_large_bytes{};
+    MemTag m_tag{};
+
+    free_list_allocator() = default;
+    free_list_allocator(const free_list_allocator&) = delete;
+    free_list_allocator& operator=(const free_list_allocator&) = delete;
+    ~free_list_allocator();
+
+    void* allocate(size_t size, size_t alignment);
+    // same size and alignment as the allocate call
+    void deallocate(void* ptr, size_t size, size_t alignment);
+
+    // live/total blocks per class to tracy, once a frame
+    void plot_stats();
+
+  private:
+    static int size_class(size_t size);
+    void refill(int pool_index);
 };
 
 //EASTL
@@ -217,8 +374,113 @@ struct free_list_allocator {
 
 
 namespace temp {
+// vector over a linear_allocator, old blocks are abandoned in the arena so growth tries to
+// extend the current block in place first
 template <typename T>
-// using vector = std::vector<T, alloc_ref<T, monotonic_allocator>>;
-    using vector = std::vector<T, alloc_ref<T, linear_allocator>>;
+class vector {
+  public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    vector(linear_allocator& allocator) : m_allocator(&allocator) {}
+
+    vector(const vector&) = delete;
+    vector& operator=(const vector&) = delete;
+
+    vector(vector&& other) noexcept :
+        m_allocator(other.m_allocator), m_data(other.m_data), m_size(other.m_size), m_capacity(other.m_capacity) {
+        other.m_data = nullptr;
+        other.m_size = 0;
+        other.m_capacity = 0;
+    }
+
+    ~vector() {
+        clear();
+    }
+
+    void reserve(size_t capacity) {
+        if (capacity > m_capacity) {
+            grow_to(capacity);
+        }
+    }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (m_size == m_capacity) {
+            // args might point into the old block
+            T value(std::forward<Args>(args)...);
+            grow_to(std::max<size_t>({m_size + 1, m_capacity * 2, 8}));
+            return *new (m_data + m_size++) T(std::move(value));
+        }
+
+        return *new (m_data + m_size++) T(std::forward<Args>(args)...);
+    }
+
+    void push_back(const T& value) {
+        emplace_back(value);
+    }
+
+    void push_back(T&& value) {
+        emplace_back(std::move(value));
+    }
+
+    void pop_back() {
+        m_data[--m_size].~T();
+    }
+
+    void clear() {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            for (size_t i = 0; i < m_size; i++) {
+                m_data[i].~T();
+            }
+        }
+        m_size = 0;
+    }
+
+    T& operator[](size_t index) { return m_data[index]; }
+    const T& operator[](size_t index) const { return m_data[index]; }
+    T& back() { return m_data[m_size - 1]; }
+    const T& back() const { return m_data[m_size - 1]; }
+
+    T* data() { return m_data; }
+    const T* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_capacity; }
+    bool empty() const { return m_size == 0; }
+
+    T* begin() { return m_data; }
+    T* end() { return m_data + m_size; }
+    const T* begin() const { return m_data; }
+    const T* end() const { return m_data + m_size; }
+
+  private:
+    void grow_to(size_t capacity) {
+        if (m_data != nullptr && m_allocator->try_extend(m_data, m_capacity * sizeof(T), capacity * sizeof(T))) {
+            m_capacity = capacity;
+            return;
+        }
+
+        T* data = (T*)m_allocator->allocate(capacity * sizeof(T), alignof(T));
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            if (m_size > 0) {
+                std::memcpy(data, m_data, m_size * sizeof(T));
+            }
+        } else {
+            for (size_t i = 0; i < m_size; i++) {
+                new (data + i) T(std::move(m_data[i]));
+                m_data[i].~T();
+            }
+        }
+
+        m_data = data;
+        m_capacity = capacity;
+    }
+
+    linear_allocator* m_allocator;
+    T* m_data{};
+    size_t m_size{};
+    size_t m_capacity{};
+};
 }
 
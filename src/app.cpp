@@ -1,9 +1,12 @@
+#include <array>
 #include <chrono>
 #include <cstddef>
 #include <filesystem>
 #include <memory>
+#include <new>
 #include <ratio>
 #include <string>
+#include <thread>
 #include <tracy/Tracy.hpp>
 
 #include "app.h"
@@ -13,9 +16,13 @@
 #include "allocator.h"
 #include "asset_loader.h"
 #include "audio.h"
+#include "calibration.h"
 #include "constants.h"
+#include "damage.h"
 #include "events.h"
 #include "font.h"
+#include "jobs.h"
+#include "mem_tags.h"
 
 #include "editor.h"
 #include "game.h"
@@ -23,6 +30,7 @@
 #include "main_menu.h"
 
 #include "memory.h"
+#include "settings.h"
 #include "systems.h"
 #include "assets.h"
 #include "ui.h"
@@ -30,21 +38,12 @@
 
 #include <vector>
 
-void* operator new(std::size_t count)
-{
-    auto ptr = malloc(count);
-    TracyAlloc (ptr , count);
-    return ptr;
-}
-
-void operator delete(void* ptr) noexcept
-{
-    TracyFree (ptr);
-    free(ptr);
-}
-
 using namespace constants;
 
+const std::filesystem::path memory_dump_path{"data/memory.json"};
+// how long an unchanged menu sleeps before checking on previews, loudness jobs and the music position again
+constexpr int idle_wake_interval_ms = 100;
+
 void create_dirs() {
     ZoneScoped;
     std::filesystem::create_directory(maps_directory);
@@ -58,11 +57,14 @@ enum class Context {
     Editor,
     Game,
     UI_Test,
+    Calibration,
 };
 
 int run() {
     create_dirs();
 
+    jobs::init(std::thread::hardware_concurrency() - 1);
+
     if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO)) {
         SDL_Log("SDL_Init failed (%s)", SDL_GetError());
         return 1;
@@ -87,16 +89,16 @@ int run() {
     input.init_keybinds(Input::default_keybindings);
     Audio audio{};
 
-    Mix_AllocateChannels(32);
+    audio.set_music_volume(0.2f);
 
-    Mix_MasterVolume(effect_volume);
-    Mix_VolumeMusic(MIX_MAX_VOLUME * 0.2f);
-
-    Font2::init_fonts(renderer);
+    {
+        mem::TagScope tag(MemTag::assets);
+        Font2::init_fonts(renderer);
+    }
 
     std::vector<SoundLoadInfo> sound_list = {
-        {"don.wav", SoundID::don},
-        {"kat.wav", SoundID::kat},
+        {"don.wav", SoundID::don, 0.7f},
+        {"kat.wav", SoundID::kat, 0.7f},
 
         {"menu_select.wav", SoundID::menu_select},
         {"menu_confirm.wav", SoundID::menu_confirm},
@@ -121,32 +123,32 @@ int run() {
     };
 
     AssetLoader assets{};
-    assets.init(renderer, image_list, sound_list);
-
-    Mix_VolumeChunk(assets.get_sound(SoundID::kat), MIX_MAX_VOLUME * 0.7);
-    Mix_VolumeChunk(assets.get_sound(SoundID::don), MIX_MAX_VOLUME * 0.7);
-
-    EventQueue event_queue{};
-
-
+    {
+        mem::TagScope tag(MemTag::assets);
+        assets.init(renderer, image_list, sound_list);
+    }
 
-    auto everything_buffer = BufferOwned(5_MiB);
-    auto everything_allocator = linear_allocator{};
-    everything_allocator.init(everything_buffer.handle());
+    Settings settings = load_settings();
 
-    MemoryAllocators memory = {.ui_allocator = linear_allocator{}};
-    memory.ui_allocator.init(everything_allocator.allocate_buffer(2_MiB, sizeof(std::max_align_t)));
+    // only address space, pages get committed as the frames actually use them
+    MemoryAllocators memory{};
+    memory.ui_allocator.reserve(1_GiB, MemTag::ui);
 
     linear_allocator debug_ui_allocator{};
-    debug_ui_allocator.init(everything_allocator.allocate_buffer(1_MiB, sizeof(std::max_align_t)));
+    debug_ui_allocator.reserve(64_MiB, MemTag::ui);
+    UICapacityHints debug_ui_hints{};
+
+    EventQueue event_queue{memory.pool_allocator};
 
 
-    Systems systems{renderer, memory, input, audio, assets, event_queue};
+    Systems systems{renderer, memory, input, audio, assets, event_queue, settings};
 
     std::unique_ptr<Editor> editor{};
     std::unique_ptr<game::Game> game{};
+    std::unique_ptr<Calibration> calibration{};
+
     std::unique_ptr<MainMenu> menu{
-        std::make_unique<MainMenu>(memory, renderer, input, audio, assets, event_queue)
+        std::make_unique<MainMenu>(memory, renderer, input, audio, assets, event_queue, settings)
     };
 
     UI_Test ui_test{memory, renderer, input};
@@ -161,6 +163,11 @@ int run() {
     std::vector<Context> context_stack{Context::Menu};
     menu->awake();
 
+    // screens draw into this instead of the backbuffer so a frame that didnt change can be
+    // skipped entirely, the backbuffer is undefined after present
+    SDL_Texture* frame_target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_TARGET, window_width, window_height);
+    bool idle = false;
+
 
     while (1) {
         auto frame_start = std::chrono::high_resolution_clock::now();
@@ -175,6 +182,9 @@ int run() {
         last_frame_start = frame_start;
 
         bool quit = false;
+        int event_count = 0;
+
+        damage::begin_frame();
 
         {
             float total_wheel{};
@@ -185,7 +195,11 @@ int run() {
 
             SDL_Event event;
             ZoneNamedN(var, "poll input", true);
-            while (SDL_PollEvent(&event)) {
+            // nothing changed last frame, block until there's input or the menu needs to check on
+            // its loads and music again instead of spinning
+            bool pending = (idle && SDL_WaitEventTimeout(&event, idle_wake_interval_ms)) || SDL_PollEvent(&event);
+            for (; pending; pending = SDL_PollEvent(&event)) {
+                event_count++;
                 ZoneNamedN(var, "event", true);
                 if (event.type == SDL_EVENT_QUIT) {
                     quit = true;
@@ -199,11 +213,19 @@ int run() {
                 if (event.type == SDL_EVENT_KEY_DOWN) {
                     input.keyboard_repeat[event.key.scancode] = true;
                     input.m_key_this_frame = event.key.scancode;
+                    if (!event.key.repeat) {
+                        input.record_key_down(event.key.scancode, event.key.timestamp);
+                    }
                 }
 
                 if (event.type == SDL_EVENT_TEXT_INPUT) {
                     input.input_text = std::string(event.text.text);
                 }
+
+                // the window or the frame target lost what was drawn, the menu cant skip its redraw
+                if (event.type == SDL_EVENT_WINDOW_EXPOSED || event.type == SDL_EVENT_RENDER_TARGETS_RESET || event.type == SDL_EVENT_RENDER_DEVICE_RESET) {
+                    damage::invalidate();
+                }
             }
             input.wheel = total_wheel;
         }
@@ -215,6 +237,8 @@ int run() {
         std::string map_filename;
 
 
+        auto context_before_events = context_stack.back();
+
         EventUnion event_union;
         while (event_queue.pop_event(&event_union)) {
             switch (event_union.index()) {
@@ -229,28 +253,34 @@ int run() {
                 context_stack.pop_back();
                 game.reset();
                 break;
-            case EventType::EditNewMap:
+            case EventType::EditNewMap: {
                 context_stack.push_back(Context::Editor);
+                mem::TagScope tag(MemTag::editor);
                 editor = std::make_unique<Editor>(memory, renderer, input, audio, assets, event_queue);
                 editor->creating_map = true;
-                break;
+            } break;
             case EventType::EditMap: {
                 auto& event = std::get<Event::EditMap>(event_union);
                 context_stack.push_back(Context::Editor);
+                mem::TagScope tag(MemTag::editor);
                 editor = std::make_unique<Editor>(memory, renderer, input, audio, assets, event_queue);
                 editor->load_mapset(event.map_directory);
             } break;
             case EventType::PlayMap: {
                 auto& event = std::get<Event::PlayMap>(event_union);
                 context_stack.push_back(Context::Game);
+                mem::TagScope tag(MemTag::map);
                 game = std::make_unique<game::Game>(systems, game::InitConfig{event.mapset_directory, event.map_filename});
             } break;
             case EventType::GameReset: {
                 auto init_config = game->config;
+                mem::TagScope tag(MemTag::map);
                 game = std::make_unique<game::Game>(systems, init_config);
-                
-
             } break;
+            case EventType::Calibrate:
+                context_stack.push_back(Context::Calibration);
+                calibration = std::make_unique<Calibration>(memory, renderer, input, audio, assets, event_queue, settings);
+                break;
             case EventType::Return:
                 switch (context_stack.back()) {
                 case Context::Editor:
@@ -262,70 +292,133 @@ int run() {
                     audio.stop();
                     menu->play_selected_music();
                     break;
+                case Context::Calibration:
+                    calibration.reset();
+                    menu->play_selected_music();
+                    break;
                 }
                 context_stack.pop_back();
                 break;
             }
         }
 
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-        SDL_RenderClear(renderer);
+        // whatever the last context drew is still in the target
+        if (context_stack.back() != context_before_events) {
+            damage::invalidate();
+        }
+
+        SDL_SetRenderTarget(renderer, frame_target);
+
+        // only the menu tracks its own damage, everything else animates and redraws every frame
+        if (context_stack.back() != Context::Menu) {
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
+            SDL_RenderClear(renderer);
+            damage::mark_dirty();
+        }
 
         switch (context_stack.back()) {
-        case Context::Menu:
+        case Context::Menu: {
+            mem::TagScope tag(MemTag::ui);
             menu->update(delta_time.count());
-            break;
+        } break;
         case Context::Game:
             game->update(delta_time);
             break;
-        case Context::Editor:
+        case Context::Editor: {
+            mem::TagScope tag(MemTag::editor);
             editor->update(delta_time);
-            break;
+        } break;
         case Context::UI_Test:
             ui_test.update(delta_time.count());
             break;
+        case Context::Calibration: {
+            mem::TagScope tag(MemTag::ui);
+            calibration->update(delta_time);
+        } break;
         }
 
-        UI debug_ui(debug_ui_allocator);
+        TracyPlot("ui arena bytes", (int64_t)memory.ui_allocator.m_current);
+        memory.pool_allocator.plot_stats();
 
-        auto frame_time_string = std::format("{:.3f} ms", std::chrono::duration<double,std::milli>(last_frame_duration).count());
-        auto ui_memory_string = std::format("UI: {:.3f} / {:.3f} MB", (float)memory.ui_allocator.m_current / (float)1_MiB, (float) memory.ui_allocator.m_capacity / (float)1_MiB );
+        if (input.key_down(SDL_SCANCODE_F9)) {
+            mem::write_json(memory_dump_path);
+        }
 
-        auto st = Style{};
-        st.position = Position::Anchor{{1, 1}};
-        st.padding = Padding{10,10,10,10};
-        st.stack_direction = StackDirection::Vertical;
-        st.align_items = Alignment::End;
+        SDL_SetRenderTarget(renderer, nullptr);
 
-        debug_ui.begin_frame(constants::window_width, constants::window_height);
+        // nothing drew this frame, the window already shows it. the overlay only refreshes with real frames
+        bool present = damage::dirty();
+        TracyPlot("frame presented", (int64_t)present);
+        if (present) {
+            SDL_RenderTexture(renderer, frame_target, NULL, NULL);
 
-        debug_ui.begin_row(st);
+            UI debug_ui(debug_ui_allocator, &debug_ui_hints);
 
-        st = {};
-        st.text_color = color::yellow;
-        debug_ui.text(ui_memory_string.data(), st);
-        debug_ui.text(frame_time_string.data(), st);
-        debug_ui.end_row();
+            auto frame_time_string = std::format("{:.3f} ms", std::chrono::duration<double,std::milli>(last_frame_duration).count());
+            auto ui_memory_string = std::format("UI: {:.3f} / {:.3f} MB, peak {:.3f} MB", (float)memory.ui_allocator.m_current / (float)1_MiB, (float)memory.ui_allocator.m_committed / (float)1_MiB, (float)memory.ui_allocator.m_high_water / (float)1_MiB);
 
-        debug_ui.end_frame(input);
+            // one line per tag, live / peak and allocations this frame
+            auto tag_stats = mem::stats();
+            auto heap_allocs_string = std::format("heap: {} allocs", mem::frame_heap_allocations());
+            auto layout_stats = ui_layout_stats();
+            auto layout_string = std::format("layout: {} subtrees reused, {} / {} rows", layout_stats.subtrees_reused, layout_stats.rows_reused, layout_stats.rows_reused + layout_stats.rows_laid_out);
+            std::array<std::string, mem_tag_count> tag_strings;
+            for (int i = 0; i < mem_tag_count; i++) {
+                auto& stats = tag_stats[i];
+                tag_strings[i] = std::format("{}: {:.3f} MB, peak {:.3f} MB, {} allocs", mem_tag_name((MemTag)i), (float)stats.live_bytes / (float)1_MiB, (float)stats.peak_bytes / (float)1_MiB, stats.frame_allocations);
+            }
 
-        debug_ui.draw(renderer);
+            auto st = Style{};
+            st.position = Position::Anchor{{1, 1}};
+            st.padding = Padding{10,10,10,10};
+            st.stack_direction = StackDirection::Vertical;
+            st.align_items = Alignment::End;
 
-        {
-            ZoneNamedN(v, "SDL_RenderPresent", true);
-            SDL_RenderPresent(renderer);
-        }
+            debug_ui.begin_frame(constants::window_width, constants::window_height);
+
+            debug_ui.begin_row(st);
+
+            st = {};
+            st.text_color = color::yellow;
+            debug_ui.text(ui_memory_string.data(), st);
+            for (auto& tag_string : tag_strings) {
+                debug_ui.text(tag_string.data(), st);
+            }
+            debug_ui.text(heap_allocs_string.data(), st);
+            debug_ui.text(layout_string.data(), st);
+            debug_ui.text(frame_time_string.data(), st);
+            debug_ui.end_row();
+
+            debug_ui.end_frame(input);
 
-        last_frame_duration = std::chrono::high_resolution_clock::now() - frame_start;
+            debug_ui.draw(renderer);
+
+            {
+                ZoneNamedN(v, "SDL_RenderPresent", true);
+                SDL_RenderPresent(renderer);
+            }
+
+            last_frame_duration = std::chrono::high_resolution_clock::now() - frame_start;
+        }
+        // input can start something (hover fades) that only shows up a frame later, stay awake for it
+        idle = !present && event_count == 0;
 
         input.end_frame();
 
         debug_ui_allocator.clear();
         memory.ui_allocator.clear();
 
+        Font2::end_frame();
+        ui_layout_end_frame();
+        mem::end_frame();
+        damage::end_frame();
+
         FrameMark;
     }
 
+    jobs::shutdown();
+
+    SDL_DestroyTexture(frame_target);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
 
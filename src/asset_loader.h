@@ -6,8 +6,10 @@
 #include <optional>
 #include <filesystem>
 #include <array>
+#include <memory>
 
 #include "color.h"
+#include "pcm.h"
 
 struct Image {
     SDL_Texture* texture;
@@ -23,6 +25,8 @@ struct ImageLoadInfo {
 struct SoundLoadInfo {
     const char* file_name;
     int index;
+    // baked into the samples at load
+    float gain = 1;
 };
 
 namespace engine {
@@ -32,10 +36,10 @@ namespace engine {
     public:
         void init(SDL_Renderer* renderer, std::vector<ImageLoadInfo>& image_list, std::vector<SoundLoadInfo>& sound_list);
         Image get_image(int id);
-        Mix_Chunk* get_sound(int id);
+        const PcmTrack* get_sound(int id);
     private:
         std::array<Image, image_count> images;
-        std::array<Mix_Chunk*, sound_count> sounds;
+        std::array<std::shared_ptr<PcmTrack>, sound_count> sounds;
     };
 
 }
@@ -68,8 +72,8 @@ namespace engine {
     }
 
     template<int image_count, int sound_count>
-    Mix_Chunk* AssetLoader<image_count, sound_count>::get_sound(int id) {
-        return sounds[id];
+    const PcmTrack* AssetLoader<image_count, sound_count>::get_sound(int id) {
+        return sounds[id].get();
     }
 
     template<int image_count, int sound_count>
@@ -82,7 +86,14 @@ namespace engine {
         }
 
         for (const auto& load_info : sound_list) {
-            sounds[load_info.index] = Mix_LoadWAV((asset_directory / load_info.file_name).string().data());
+            // decoded up front so the effects mixer only ever sums floats
+            auto sound = decode_pcm((asset_directory / load_info.file_name).string().data());
+            if (sound != nullptr) {
+                for (auto& sample : sound->samples) {
+                    sample *= load_info.gain;
+                }
+            }
+            sounds[load_info.index] = std::move(sound);
         }
     }
 
@@ -1,21 +1,32 @@
 #include <SDL3/SDL.h>
 #include <chrono>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
 #include <stdlib.h>
 #include <iostream>
 #include <format>
+#include <string>
+#include <tracy/Tracy.hpp>
 
 #include "audio.h"
+#include "jobs.h"
+#include "mem_tags.h"
 #include "SDL3_mixer/SDL_mixer.h"
+#include "simd.h"
 
-Audio::Audio() {
-    Mix_OpenAudio(0, NULL);
+Audio::Audio(int buffer_frames) {
+    SDL_SetHint(SDL_HINT_AUDIO_DEVICE_SAMPLE_FRAMES, std::to_string(buffer_frames).data());
+
+    SDL_AudioSpec spec{SDL_AUDIO_F32, mixer_channels, mixer_frequency};
+    Mix_OpenAudio(0, &spec);
+
+    Mix_SetPostMix(effects_hook, this);
 }
 
 // return 0 on success, 1 on error
 int Audio::load_music(const char* file_path) {
-    if (m_music != nullptr) {
-        this->stop();
-    }
+    this->stop();
 
     auto result = Mix_LoadMUS(file_path);
     if (result == NULL) {
@@ -28,46 +39,134 @@ int Audio::load_music(const char* file_path) {
     return 0;
 }
 
+PendingMusic::~PendingMusic() {
+    if (music != nullptr) {
+        Mix_FreeMusic(music);
+    }
+}
+
+MusicLoad load_music_async(std::filesystem::path file_path) {
+    auto load = std::make_shared<PendingMusic>();
+
+    // the job keeps its own reference so the handle can be dropped mid load
+    jobs::push([load, file_path = std::move(file_path)]() {
+        mem::TagScope tag(MemTag::audio);
+        load->music = Mix_LoadMUS(file_path.string().data());
+        load->done = true;
+    });
+
+    return load;
+}
+
+bool music_loaded(const MusicLoad& load) {
+    return load != nullptr && load->done;
+}
+
+// return 0 on success, 1 on error
+int Audio::use_music(const MusicLoad& load) {
+    if (!music_loaded(load)) {
+        return 1;
+    }
+
+    this->stop();
+
+    if (load->music == nullptr) {
+        return 1;
+    }
+
+    m_music = load->music;
+    load->music = nullptr;
+    elapsed_at_last_time = 0;
+
+    return 0;
+}
+
 void Audio::fade_in(int loops, int ms) {
+    if (m_pcm != nullptr) {
+        m_pcm_fade_length = (int64_t)ms * m_pcm->frequency / 1000;
+        m_pcm_fade_remaining = m_pcm_fade_length;
+        this->play(loops);
+        return;
+    }
+
     Mix_FadeInMusic(m_music, loops, ms);
     m_loops = loops;
     last_time = std::chrono::high_resolution_clock::now();
 }
 
 void Audio::play(int loops) {
-    Mix_PlayMusic(m_music, loops);
+    if (m_pcm != nullptr) {
+        m_pcm_cursor = 0;
+        m_pcm_loops = loops;
+        m_pcm_paused = false;
+    } else {
+        Mix_PlayMusic(m_music, loops);
+    }
     m_loops = loops;
+    elapsed_at_last_time = 0;
     last_time = std::chrono::high_resolution_clock::now();
 }
 
+void Audio::release_pcm() {
+    if (m_pcm == nullptr) {
+        return;
+    }
+
+    // unhooking takes the mixer lock so the callback is done with the buffer after this
+    Mix_HookMusic(NULL, NULL);
+    m_pcm.reset();
+    m_pcm_paused = true;
+}
+
 void Audio::stop() {
+    release_pcm();
+
     Mix_FreeMusic(m_music);
     m_music = nullptr;
 }
 
 void Audio::resume() {
-    Mix_ResumeMusic();
+    if (m_pcm != nullptr) {
+        m_pcm_paused = false;
+    } else {
+        Mix_ResumeMusic();
+    }
     last_time = std::chrono::high_resolution_clock::now();
 }
 
 void Audio::pause() {
-    if (!Mix_PlayingMusic()) {
-        return;
-    }
+    if (m_pcm != nullptr) {
+        if (m_pcm_paused) {
+            return;
+        }
+        m_pcm_paused = true;
+    } else {
+        if (!Mix_PlayingMusic()) {
+            return;
+        }
 
-    Mix_PauseMusic();
+        Mix_PauseMusic();
+    }
     elapsed_at_last_time += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - last_time).count();
 }
 
+double Audio::duration() {
+    if (m_pcm != nullptr) {
+        return m_pcm->duration();
+    }
+
+    return Mix_MusicDuration(m_music);
+}
+
 double Audio::get_position() {
-    if (m_music == nullptr) {
+    if (m_music == nullptr && m_pcm == nullptr) {
         return 0;
     }
 
     double current_elapsed = elapsed_at_last_time;
     if (!paused()) {
         current_elapsed = elapsed_at_last_time + std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - last_time).count();
-        auto duration = Mix_MusicDuration(m_music);
+        auto duration = this->duration();
         if (current_elapsed > duration) {
             if (m_loops > 0) {
                 current_elapsed = std::fmod(current_elapsed, duration);
@@ -89,11 +188,208 @@ void Audio::set_position(double position) {
     if (position < 0) {
         position = 0;
     }
-    Mix_SetMusicPosition(position);
+    if (m_pcm != nullptr) {
+        auto frame = (int64_t)std::llround(position * m_pcm->frequency);
+        m_pcm_cursor = std::min(frame, m_pcm->frames());
+    } else {
+        Mix_SetMusicPosition(position);
+    }
     elapsed_at_last_time = position;
     last_time = std::chrono::high_resolution_clock::now();
 }
 
 bool Audio::paused() {
+    if (m_pcm != nullptr) {
+        return m_pcm_paused;
+    }
+
     return (bool)Mix_PausedMusic();
 }
+
+void Audio::use_pcm(std::shared_ptr<const PcmTrack> track) {
+    if (track == nullptr || track->channels != mixer_channels) {
+        return;
+    }
+
+    double position = get_position();
+    bool was_paused = paused();
+
+    release_pcm();
+    Mix_HaltMusic();
+
+    m_pcm = std::move(track);
+    m_pcm_loops = m_loops;
+    m_pcm_paused = was_paused;
+    m_pcm_fade_remaining = 0;
+    set_position(position);
+
+    Mix_HookMusic(pcm_hook, this);
+}
+
+void Audio::play_pcm(std::shared_ptr<const PcmTrack> track, int loops, int fade_ms) {
+    this->stop();
+
+    if (track == nullptr || track->channels != mixer_channels) {
+        return;
+    }
+
+    m_pcm = std::move(track);
+    this->fade_in(loops, fade_ms);
+
+    Mix_HookMusic(pcm_hook, this);
+}
+
+// runs on the audio thread with the mixer locked
+void Audio::pcm_hook(void* userdata, Uint8* stream, int length) {
+    auto audio = (Audio*)userdata;
+    const auto& track = *audio->m_pcm;
+    auto out = (float*)stream;
+    const int64_t out_frames = length / (sizeof(float) * track.channels);
+
+    if (audio->m_pcm_paused) {
+        std::memset(stream, 0, length);
+        return;
+    }
+
+    const float gain = Mix_VolumeMusic(-1) / (float)MIX_MAX_VOLUME;
+    const int64_t start_cursor = audio->m_pcm_cursor;
+    int64_t cursor = start_cursor;
+
+    const int64_t start_fade = audio->m_pcm_fade_remaining;
+    int64_t fade_remaining = start_fade;
+    const float fade_step = fade_remaining > 0 ? 1.0f / audio->m_pcm_fade_length : 0;
+
+    int64_t written = 0;
+    while (written < out_frames) {
+        if (cursor >= track.frames()) {
+            if (audio->m_pcm_loops <= 0) {
+                std::memset(out + written * track.channels, 0, (out_frames - written) * track.channels * sizeof(float));
+                break;
+            }
+            audio->m_pcm_loops--;
+            cursor = 0;
+        }
+
+        int64_t count = std::min(out_frames - written, track.frames() - cursor);
+        const float* src = track.samples.data() + cursor * track.channels;
+        float* dst = out + written * track.channels;
+        int64_t i = 0;
+        for (; fade_remaining > 0 && i < count; i++, fade_remaining--) {
+            float faded = gain * (1.0f - fade_remaining * fade_step);
+            for (int c = 0; c < track.channels; c++) {
+                dst[i * track.channels + c] = src[i * track.channels + c] * faded;
+            }
+        }
+        for (i *= track.channels; i < count * track.channels; i++) {
+            dst[i] = src[i] * gain;
+        }
+
+        written += count;
+        cursor += count;
+    }
+
+    int64_t expected_fade = start_fade;
+    audio->m_pcm_fade_remaining.compare_exchange_strong(expected_fade, fade_remaining);
+
+    // dont clobber a seek that came in while mixing
+    int64_t expected = start_cursor;
+    audio->m_pcm_cursor.compare_exchange_strong(expected, cursor);
+}
+
+void Audio::play_sound(const PcmTrack* sound) {
+    if (sound == nullptr || sound->channels != mixer_channels) {
+        return;
+    }
+
+    m_sound_triggers.push({sound, SDL_GetTicksNS(), 0});
+}
+
+void Audio::play_sound_at(const PcmTrack* sound, uint64_t start_ns) {
+    if (sound == nullptr || sound->channels != mixer_channels) {
+        return;
+    }
+
+    m_sound_triggers.push({sound, SDL_GetTicksNS(), start_ns});
+}
+
+void Audio::set_effect_volume(float volume) {
+    m_effect_volume = std::clamp(volume, 0.0f, 1.0f);
+}
+
+float Audio::effect_volume() {
+    return m_effect_volume;
+}
+
+void Audio::set_music_volume(float volume) {
+    m_music_volume = std::clamp(volume, 0.0f, 1.0f);
+    apply_music_volume();
+}
+
+float Audio::music_volume() {
+    return m_music_volume;
+}
+
+void Audio::set_music_gain(float gain) {
+    m_music_gain = std::clamp(gain, 0.0f, 1.0f);
+    apply_music_volume();
+}
+
+void Audio::apply_music_volume() {
+    Mix_VolumeMusic((int)std::lround(MIX_MAX_VOLUME * m_music_volume * m_music_gain));
+}
+
+// runs on the audio thread after music is mixed
+void Audio::effects_hook(void* userdata, Uint8* stream, int length) {
+    auto audio = (Audio*)userdata;
+    auto out = (float*)stream;
+    const int64_t out_frames = length / (sizeof(float) * mixer_channels);
+
+    // this block has a buffer to go before it reaches the device
+    const uint64_t now_ns = SDL_GetTicksNS();
+    const uint64_t block_start_ns = now_ns + out_frames * 1'000'000'000 / mixer_frequency;
+
+    SoundTrigger trigger;
+    while (audio->m_sound_triggers.pop(trigger)) {
+        // free voice, otherwise cut off whichever has played the longest
+        Voice* voice = &audio->m_voices[0];
+        for (auto& v : audio->m_voices) {
+            if (v.sound == nullptr) {
+                voice = &v;
+                break;
+            }
+            if (v.cursor > voice->cursor) {
+                voice = &v;
+            }
+        }
+        int64_t delay = 0;
+        if (trigger.start_ns > block_start_ns) {
+            delay = (int64_t)((trigger.start_ns - block_start_ns) * mixer_frequency / 1'000'000'000);
+        }
+        *voice = {trigger.sound, 0, delay};
+
+        if (trigger.start_ns == 0) {
+            // time spent queued plus a buffer for this block to reach the device
+            TracyPlot("hit sound latency ms", (block_start_ns - trigger.queued_ns) / 1e6);
+        }
+    }
+
+    const float gain = audio->m_effect_volume;
+
+    for (auto& voice : audio->m_voices) {
+        if (voice.sound == nullptr) {
+            continue;
+        }
+
+        // scheduled voices sit silent until their sample comes up, possibly for a few blocks
+        int64_t offset = std::min(voice.delay, out_frames);
+        voice.delay -= offset;
+
+        int64_t count = std::min(out_frames - offset, voice.sound->frames() - voice.cursor);
+        simd::mix_add(out + offset * mixer_channels, voice.sound->samples.data() + voice.cursor * mixer_channels, count * mixer_channels, gain);
+
+        voice.cursor += count;
+        if (voice.cursor >= voice.sound->frames()) {
+            voice.sound = nullptr;
+        }
+    }
+}
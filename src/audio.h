@@ -1,9 +1,22 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <filesystem>
+#include <memory>
 #include <SDL3_mixer/SDL_mixer.h>
 
-static int effect_volume{(int)(MIX_MAX_VOLUME * 0.3)};
+#include "pcm.h"
+#include "spsc_queue.h"
+
+// mixer runs in f32 so decoded tracks can be handed straight to the hook
+constexpr int mixer_frequency = 44100;
+constexpr int mixer_channels = 2;
+
+// device buffer in frames, hit sounds can only start on a buffer boundary so keep it small
+constexpr int default_audio_buffer_frames = 256;
+constexpr int max_sound_voices = 32;
 
 enum class AudioState {
     initial,
@@ -12,21 +25,63 @@ enum class AudioState {
     stopped,
 };
 
+// music opened on a worker, hand it to Audio::use_music once its done
+// frees the music if the handle is dropped without it being claimed
+struct PendingMusic {
+    ~PendingMusic();
+
+    std::atomic<bool> done{};
+    // only touch once done is set
+    Mix_Music* music = nullptr;
+};
+
+using MusicLoad = std::shared_ptr<PendingMusic>;
+
+MusicLoad load_music_async(std::filesystem::path file_path);
+bool music_loaded(const MusicLoad& load);
+
 // need to wrap audio cuz changing lib a lot
 // keep track of time also
 class Audio {
 public:
-    Audio();
+    Audio(int buffer_frames = default_audio_buffer_frames);
     int load_music(const char* file_path);
+    // same as load_music for a finished async load
+    int use_music(const MusicLoad& load);
     void resume();
     void pause();
     void stop();
     void set_position(double position);
     double get_position();
+    double duration();
     bool paused();
     void play(int loops);
     void fade_in(int loops, int ms);
 
+    // switch the loaded music over to a decoded copy of it, keeps position and paused state
+    // seeking is then sample accurate instead of going through Mix_SetMusicPosition
+    void use_pcm(std::shared_ptr<const PcmTrack> track);
+
+    // one shot effect mixed over the music, sound has to outlive playback (assets do)
+    // render thread only
+    void play_sound(const PcmTrack* sound);
+    // same but starts on the sample that reaches the device at start_ns (SDL_GetTicksNS clock)
+    // queue it a few buffers early, if its already late it starts straight away
+    void play_sound_at(const PcmTrack* sound, uint64_t start_ns);
+    void set_effect_volume(float volume);
+    float effect_volume();
+
+    // slider volume times the current tracks loudness gain ends up in Mix_VolumeMusic
+    void set_music_volume(float volume);
+    float music_volume();
+    void set_music_gain(float gain);
+
+    // plays a decoded track on its own with no streamed music behind it
+    void play_pcm(std::shared_ptr<const PcmTrack> track, int loops, int fade_ms);
+
+    // Mix_SetPostMix callback, public so the latency test can chain it behind a probe
+    static void effects_hook(void* userdata, Uint8* stream, int length);
+
     Mix_Music* m_music = nullptr;
     double elapsed_at_last_time = 0;
 
@@ -34,4 +89,38 @@ public:
 
 private:
     std::chrono::time_point<std::chrono::high_resolution_clock> last_time;
+
+    std::shared_ptr<const PcmTrack> m_pcm;
+    std::atomic<int64_t> m_pcm_cursor{};
+    std::atomic<bool> m_pcm_paused{true};
+    std::atomic<int> m_pcm_loops{};
+    // frames left in the fade in and how long it is overall
+    std::atomic<int64_t> m_pcm_fade_remaining{};
+    int64_t m_pcm_fade_length{};
+
+    static void pcm_hook(void* userdata, Uint8* stream, int length);
+    void release_pcm();
+
+    struct SoundTrigger {
+        const PcmTrack* sound;
+        uint64_t queued_ns;
+        // 0 for as soon as possible
+        uint64_t start_ns;
+    };
+
+    struct Voice {
+        const PcmTrack* sound;
+        int64_t cursor;
+        // frames of silence before it starts
+        int64_t delay;
+    };
+
+    SpscQueue<SoundTrigger, 64> m_sound_triggers;
+    // audio thread only
+    std::array<Voice, max_sound_voices> m_voices{};
+    std::atomic<float> m_effect_volume{0.3f};
+
+    float m_music_volume{1};
+    float m_music_gain{1};
+    void apply_music_volume();
 };
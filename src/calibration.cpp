@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <tracy/Tracy.hpp>
+
+#include "calibration.h"
+#include "color.h"
+#include "constants.h"
+#include "ui.h"
+
+constexpr double calibration_bpm = 120;
+constexpr double lead_in = 1;
+// taps before this beat are the player finding the rhythm
+constexpr int warmup_beats = 4;
+constexpr int min_calibration_taps = 16;
+// clicks go to the mixer this far ahead with the time they should be heard, so they land on
+// the beat to the sample instead of whenever a frame gets to them
+constexpr double schedule_ahead = 0.1;
+
+Calibration::Calibration(MemoryAllocators& memory, SDL_Renderer* renderer, Input::Input& input, Audio& audio, AssetLoader& assets, EventQueue& event_queue, Settings& settings)
+    : memory(memory), renderer(renderer), input(input), audio(audio), assets(assets), event_queue(event_queue), settings(settings),
+      m_start_ns(SDL_GetTicksNS()) {
+    audio.stop();
+}
+
+double Calibration::beat_time(int beat) {
+    return lead_in + beat * 60 / calibration_bpm;
+}
+
+void Calibration::update(std::chrono::duration<double> delta_time) {
+    ZoneScoped;
+
+    double now = (SDL_GetTicksNS() - m_start_ns) / 1e9;
+
+    while (now + schedule_ahead >= beat_time(m_next_beat)) {
+        audio.play_sound_at(assets.get_sound(SoundID::don), m_start_ns + (uint64_t)(beat_time(m_next_beat) * 1e9));
+        m_next_beat++;
+    }
+
+    // the key events time, not this frames, so polling and frame pacing dont end up in the offset
+    std::optional<uint64_t> tap_ns;
+    for (int action = 0; action < Input::ActionID::count; action++) {
+        if (input.action_down(action)) {
+            uint64_t pressed_ns = input.action_down_ns(action);
+            if (pressed_ns == 0) {
+                // state changed without an event reaching us, the frame is the best there is
+                pressed_ns = SDL_GetTicksNS();
+            }
+            tap_ns = std::min(tap_ns.value_or(pressed_ns), pressed_ns);
+        }
+    }
+
+    if (tap_ns.has_value() && tap_ns.value() > m_start_ns) {
+        double tap_time = (tap_ns.value() - m_start_ns) / 1e9;
+        int beat = (int)std::lround((tap_time - lead_in) * calibration_bpm / 60);
+        if (beat >= warmup_beats && beat <= m_next_beat) {
+            m_errors.push_back(tap_time - beat_time(beat));
+            m_estimate = estimate_offset(m_errors);
+        }
+    }
+
+    if (input.key_down(SDL_SCANCODE_ESCAPE)) {
+        audio.play_sound(assets.get_sound(SoundID::menu_back));
+        event_queue.push_event(Event::Return{});
+    }
+
+    UI ui(memory.ui_allocator, &m_ui_hints, &m_ui_layout);
+    ui.begin_frame(constants::window_width, constants::window_height);
+
+    Style style{};
+    style.position = Position::Anchor{0.5, 0.5};
+    style.stack_direction = StackDirection::Vertical;
+    style.align_items = Alignment::Center;
+    style.gap = 20;
+    ui.begin_row(style);
+
+    ui.text("Tap along with the beat", {.font_size = 44});
+    ui.text(ui.strings.add(std::format("current offset {:+.1f} ms", settings.global_offset * 1000)), {.text_color = RGBA{180, 180, 180, 255}});
+
+    if (m_estimate.has_value()) {
+        const auto& estimate = m_estimate.value();
+        ui.text(ui.strings.add(std::format("{:+.1f} ms  jitter {:.1f} ms", estimate.mean * 1000, estimate.jitter * 1000)), {.font_size = 56});
+        ui.text(ui.strings.add(std::format("{} taps, {} ignored", estimate.used, estimate.rejected)), {});
+    } else {
+        ui.text(ui.strings.add(std::format("{} taps", m_errors.size())), {});
+    }
+
+    ui.begin_row({.gap = 20});
+    if (m_estimate.has_value() && m_estimate->used >= min_calibration_taps) {
+        ui.button("Apply", {}, [&]() {
+            settings.global_offset = m_estimate->mean;
+            settings.offset_samples = m_estimate->used;
+            save_settings(settings);
+            audio.play_sound(assets.get_sound(SoundID::menu_confirm));
+        });
+    }
+    ui.button("Reset", {}, [&]() {
+        m_errors.clear();
+        m_estimate.reset();
+    });
+    ui.button("Back", {}, [&]() {
+        event_queue.push_event(Event::Return{});
+    });
+    ui.end_row();
+
+    ui.end_row();
+
+    ui.end_frame(input);
+    ui.draw(renderer);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include <chrono>
+#include <optional>
+#include <vector>
+
+#include "memory.h"
+#include "settings.h"
+#include "systems.h"
+#include "timing_stats.h"
+#include "ui.h"
+
+// metronome screen, measures how late the player taps relative to what they hear
+class Calibration {
+  public:
+    Calibration(MemoryAllocators& memory, SDL_Renderer* renderer, Input::Input& input, Audio& audio, AssetLoader& assets, EventQueue& event_queue, Settings& settings);
+    void update(std::chrono::duration<double> delta_time);
+
+  private:
+    double beat_time(int beat);
+
+    MemoryAllocators& memory;
+    SDL_Renderer* renderer;
+    Input::Input& input;
+    Audio& audio;
+    AssetLoader& assets;
+    EventQueue& event_queue;
+    Settings& settings;
+
+    // SDL_GetTicksNS, the clock the mixer schedules against
+    uint64_t m_start_ns{};
+    int m_next_beat{};
+
+    std::vector<double> m_errors;
+    std::optional<OffsetEstimate> m_estimate;
+
+    UICapacityHints m_ui_hints{};
+    UILayoutCache m_ui_layout{};
+};
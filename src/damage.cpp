@@ -0,0 +1,42 @@
+#include "damage.h"
+
+namespace damage {
+
+namespace {
+
+bool frame_dirty = false;
+bool target_invalid = true;
+bool invalid_next_frame = false;
+
+} // namespace
+
+void begin_frame() {
+    frame_dirty = false;
+}
+
+void end_frame() {
+    target_invalid = invalid_next_frame;
+    invalid_next_frame = false;
+}
+
+void mark_dirty() {
+    frame_dirty = true;
+}
+
+bool dirty() {
+    return frame_dirty;
+}
+
+void invalidate() {
+    target_invalid = true;
+}
+
+bool invalidated() {
+    return target_invalid;
+}
+
+void invalidate_next_frame() {
+    invalid_next_frame = true;
+}
+
+} // namespace damage
@@ -0,0 +1,25 @@
+#pragma once
+
+// frame level damage for the app loop. everything draws into a persistent target, a screen
+// whose output would come out the same skips drawing, and a frame nobody marked dirty isnt
+// presented, the loop sleeps until input or the idle timeout instead
+namespace damage {
+
+// call once at the top of the loop
+void begin_frame();
+void end_frame();
+
+// something was drawn into the frame target this frame
+void mark_dirty();
+bool dirty();
+
+// the target doesnt hold what the screens last drew anymore (context switch), screens have
+// to redraw this frame even if nothing changed on their side
+void invalidate();
+bool invalidated();
+
+// something couldnt finish drawing this frame (glyphs over the raster budget), the next frame
+// counts as invalidated so it gets drawn again
+void invalidate_next_frame();
+
+} // namespace damage
@@ -1,15 +1,19 @@
 #include <cmath>
+#include <format>
 #include <iostream>
 #include <limits>
 #include <tracy/Tracy.hpp>
 
 #include "editor.h"
+#include "loudness.h"
 #include "constants.h"
+#include "dev_macros.h"
 #include "map.h"
 #include "memory.h"
 #include "serialize.h"
 #include "color.h"
 #include "game.h"
+#include "jobs.h"
 
 #include "assets.h"
 #include "ui.h"
@@ -34,7 +38,8 @@ void remove_note(Map& map, std::vector<bool>& selected, int i) {
     selected.erase(selected.begin() + i);
 }
 
-std::vector<int> note_box_intersection(const Map& map, Vec2 start_pos, Vec2 end_pos) {
+// hits live in scratch, which the caller owns the scope for
+temp::vector<int> note_box_intersection(linear_allocator& scratch, const Map& map, Vec2 start_pos, Vec2 end_pos) {
     if (end_pos.x < start_pos.x) {
         float temp = start_pos.x;
         start_pos.x = end_pos.x;
@@ -47,7 +52,7 @@ std::vector<int> note_box_intersection(const Map& map, Vec2 start_pos, Vec2 end_
         end_pos.y = temp;
     }
 
-    std::vector<int> hits;
+    temp::vector<int> hits(scratch);
 
     for (int i = 0; i < map.times.size(); i++) {
         const float& x = map.times[i];
@@ -126,7 +131,8 @@ void draw_map_editor(SDL_Renderer* renderer, AssetLoader& assets, const Map& map
 
 std::optional<int> note_point_intersection(const Map& map, const Vec2& point, const int& current_note) {
     Vec2 half_bounds = note_hitbox / 2;
-    std::vector<int> hits;
+    ScratchScope scratch;
+    temp::vector<int> hits(scratch.arena);
     for (int i = 0; i < map.times.size(); i++) {
         Vec2 center = { static_cast<float>(map.times[i]), 0 };
         Vec2 top_left = { center.x - half_bounds.x, center.y + half_bounds.y };
@@ -154,7 +160,7 @@ std::optional<int> note_point_intersection(const Map& map, const Vec2& point, co
 }
 
 Editor::Editor(MemoryAllocators& memory, SDL_Renderer* _renderer, Input::Input& _input, Audio& _audio, AssetLoader& _assets, EventQueue& _event_queue)
-    : memory(memory), ui(memory.ui_allocator), renderer{ _renderer }, input{ _input }, audio{ _audio }, assets{ _assets }, event_queue{ _event_queue } {}
+    : memory(memory), ui(memory.ui_allocator, &m_ui_hints, &m_ui_layout), renderer{ _renderer }, input{ _input }, audio{ _audio }, assets{ _assets }, event_queue{ _event_queue } {}
 
 Editor::~Editor() {
 }
@@ -167,13 +173,26 @@ void Editor::load_mapset(std::filesystem::path& mapset_directory) {
     m_mapset_directory = mapset_directory;
 
     load_binary(mapset_info, (m_mapset_directory / mapset_filename));
+    audio.set_music_gain(loudness_gain(mapset_info));
     m_selected = std::vector<bool>(m_map.times.size(), false);
 
     auto music_file = find_music_file(mapset_directory);
 
     if (music_file.has_value()) {
-        audio.load_music(music_file.value().string().data());
-        audio.play(std::numeric_limits<int>::max());
+        audio.stop();
+        m_music_load = load_music_async(music_file.value());
+
+        // stream until the decoded copy is ready
+        m_pcm_decode = jobs::submit([path = music_file.value().string()]() {
+            mem::TagScope tag(MemTag::editor);
+            return decode_pcm(path.data());
+        });
+
+        m_music_file = music_file.value();
+        m_waveform_job = jobs::submit([directory = m_mapset_directory, music_file = m_music_file]() {
+            mem::TagScope tag(MemTag::editor);
+            return load_waveform_cache(directory, music_file);
+        });
     }
 
     m_map_infos.clear();
@@ -240,7 +259,43 @@ void Editor::update(std::chrono::duration<double> delta_time) {
     // ui.~UI();
     // new (&ui) UI(memory.ui_allocator);
     //
-    reinitialize(&ui, memory.ui_allocator);
+    reinitialize(&ui, memory.ui_allocator, &m_ui_hints, &m_ui_layout);
+
+    if (music_loaded(m_music_load)) {
+        if (audio.use_music(m_music_load) == 0) {
+            audio.play(std::numeric_limits<int>::max());
+        }
+        m_music_load.reset();
+    }
+
+    if (jobs::ready(m_pcm_decode)) {
+        m_pcm = m_pcm_decode.get();
+
+        if (m_pcm != nullptr && m_music_load != nullptr) {
+            m_music_load.reset();
+            audio.play_pcm(m_pcm, std::numeric_limits<int>::max(), 0);
+        } else {
+            audio.use_pcm(m_pcm);
+        }
+    }
+
+    if (jobs::ready(m_waveform_job)) {
+        m_waveform = m_waveform_job.get();
+    }
+
+    if (m_waveform == nullptr && !m_waveform_job.valid() && m_pcm != nullptr) {
+        m_waveform_job = jobs::submit([pcm = m_pcm, directory = m_mapset_directory, music_file = m_music_file]() {
+            mem::TagScope tag(MemTag::editor);
+            auto peaks = build_waveform(*pcm, music_file);
+            // the peaks are fine even if the cache cant be written, just rebuild next time
+            try {
+                save_waveform_cache(*peaks, directory);
+            } catch (const std::exception& e) {
+                DEV_LOG(std::format("waveform: couldnt write cache, {}\n", e.what()));
+            }
+            return peaks;
+        });
+    }
 
     ui.begin_frame(constants::window_width, constants::window_height);
 
@@ -485,6 +540,35 @@ void Editor::update(std::chrono::duration<double> delta_time) {
             m_map.m_meta_data.offset = std::stof(offset.text);
         }
 
+        if (jobs::ready(m_tempo_job)) {
+            m_tempo_suggestion = m_tempo_job.get();
+        }
+
+        if (m_tempo_job.valid()) {
+            ui.text("detecting...", {});
+        } else if (m_pcm != nullptr) {
+            ui.button("Detect", {}, [&]() {
+                m_tempo_suggestion.reset();
+                m_tempo_job = jobs::submit([pcm = m_pcm]() {
+                    mem::TagScope tag(MemTag::editor);
+                    return estimate_tempo(*pcm);
+                });
+            });
+        }
+
+        if (m_tempo_suggestion.has_value()) {
+            auto suggestion = m_tempo_suggestion.value();
+
+            ui.begin_row({ .gap{10} });
+            ui.text(ui.strings.add(std::format("{:.2f} bpm  {:.3f} s", suggestion.bpm, suggestion.offset)), {});
+            ui.button("Apply", {}, [this, suggestion]() {
+                m_map.m_meta_data.bpm = suggestion.bpm;
+                m_map.m_meta_data.offset = suggestion.offset;
+                m_tempo_suggestion.reset();
+            });
+            ui.end_row();
+        }
+
         ui.end_row();
         break;
     }
@@ -581,7 +665,12 @@ void Editor::main_update() {
     }
 
     float seek = 0;
-    seek += input.wheel;
+    if (input.modifier(SDL_KMOD_LCTRL)) {
+        // zoom the time axis only, notes keep their size
+        cam.bounds.x = std::clamp(cam.bounds.x * std::pow(0.8f, input.wheel), 0.25f, 60.0f);
+    } else {
+        seek += input.wheel;
+    }
 
     if (input.key_down(SDL_SCANCODE_LEFT)) {
         if (input.modifier(SDL_KMOD_LCTRL)) {
@@ -627,7 +716,8 @@ void Editor::main_update() {
 
         if (input.mouse_held(SDL_BUTTON_LMASK)) {
             if (box_select_begin.has_value()) {
-                auto hits = note_box_intersection(m_map, box_select_begin.value(), cursor_pos);
+                ScratchScope scratch;
+                auto hits = note_box_intersection(scratch.arena, m_map, box_select_begin.value(), cursor_pos);
                 std::fill(m_selected.begin(), m_selected.end(), false);
 
                 for (auto& i : hits) {
@@ -700,16 +790,16 @@ void Editor::main_update() {
     if (!audio.paused() && current_note < m_map.times.size() && elapsed >= m_map.times[current_note]) {
         switch (m_map.flags_list[current_note]) {
         case (NoteFlagBits::don | NoteFlagBits::small):
-            Mix_PlayChannel(-1, assets.get_sound(SoundID::don), 0);
+            audio.play_sound(assets.get_sound(SoundID::don));
             break;
         case (0 | NoteFlagBits::small):
-            Mix_PlayChannel(-1, assets.get_sound(SoundID::kat), 0);
+            audio.play_sound(assets.get_sound(SoundID::kat));
             break;
         case (NoteFlagBits::don | 0):
-            Mix_PlayChannel(-1, assets.get_sound(SoundID::kat), 0);
+            audio.play_sound(assets.get_sound(SoundID::kat));
             break;
         case (0 | 0):
-            Mix_PlayChannel(-1, assets.get_sound(SoundID::kat), 0);
+            audio.play_sound(assets.get_sound(SoundID::kat));
             break;
         }
 
@@ -717,6 +807,10 @@ void Editor::main_update() {
     }
 
 
+    if (m_waveform != nullptr) {
+        draw_waveform(renderer, memory.ui_allocator, *m_waveform, cam, -0.45f, 0.2f, RGBA{70, 110, 160, 255});
+    }
+
     float right_bound =cam.position.x + cam.bounds.x / 2;
     float left_bound = cam.position.x - cam.bounds.x / 2;
 
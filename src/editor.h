@@ -6,6 +6,11 @@
 #include "ui.h"
 #include "constants.h"
 #include "game.h"
+#include "pcm.h"
+#include "tempo.h"
+#include "waveform.h"
+
+#include <future>
 
 enum class EditorMode {
     select,
@@ -44,6 +49,8 @@ private:
     AssetLoader& assets;
     EventQueue& event_queue;
 
+    UICapacityHints m_ui_hints{};
+    UILayoutCache m_ui_layout{};
     UI ui;
 
     Cam cam = {{0,0}, {2,1.5f}};
@@ -58,6 +65,19 @@ private:
     std::optional<Vec2> box_select_begin;
     NoteFlags insert_flags = NoteFlagBits::don | NoteFlagBits::small;
 
+    // streamed until the decode is done, dropped if the decode wins
+    MusicLoad m_music_load;
+    std::future<std::shared_ptr<PcmTrack>> m_pcm_decode;
+    std::shared_ptr<const PcmTrack> m_pcm;
+
+    // cache load first, then a build from m_pcm if the cache was missing
+    std::future<std::shared_ptr<WaveformPeaks>> m_waveform_job;
+    std::shared_ptr<const WaveformPeaks> m_waveform;
+    std::filesystem::path m_music_file;
+
+    std::future<TempoEstimate> m_tempo_job;
+    std::optional<TempoEstimate> m_tempo_suggestion;
+
     std::filesystem::path m_mapset_directory;
     std::vector<MapMeta> m_map_infos;
     std::vector<std::filesystem::path> m_map_paths;
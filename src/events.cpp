@@ -1,7 +1,9 @@
 #include "events.h"
 
+EventQueue::EventQueue(free_list_allocator& allocator) : events(Storage(allocator)) {}
+
 void EventQueue::push_event(EventUnion event) {
-    events.push(event);
+    events.push(std::move(event));
 }
 
 bool EventQueue::pop_event(EventUnion* event) {
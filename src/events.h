@@ -4,8 +4,11 @@
 #include <filesystem>
 #include <optional>
 #include <string>
+#include <deque>
 #include <queue>
 
+#include "allocator.h"
+
 namespace Event {
     struct EditNewMap {};
     struct EditMap {
@@ -20,6 +23,7 @@ namespace Event {
     };
     struct Return {};
     struct GameReset{};
+    struct Calibrate{};
 }
 
 using EventUnion = std::variant<
@@ -29,15 +33,18 @@ using EventUnion = std::variant<
     Event::QuitTest,
     Event::PlayMap,
     Event::Return,
-    Event::GameReset
+    Event::GameReset,
+    Event::Calibrate
 >;
 
 class EventQueue {
 public:
+    EventQueue(free_list_allocator& allocator);
     bool pop_event(EventUnion* event);
     void push_event(EventUnion event);
 private:
-    std::queue<EventUnion> events{};
+    using Storage = std::deque<EventUnion, alloc_ref<EventUnion, free_list_allocator>>;
+    std::queue<EventUnion, Storage> events;
 };
 
 namespace EventType {
@@ -49,5 +56,6 @@ namespace EventType {
         PlayMap,
         Return,
         GameReset,
+        Calibrate,
     };
 }
@@ -0,0 +1,84 @@
+#include <cmath>
+#include <numbers>
+#include <utility>
+
+#include "fft.h"
+#include "simd.h"
+
+FftPlan::FftPlan(int size) : size(size), m_bit_reverse(size), m_twiddle_re(size - 1), m_twiddle_im(size - 1) {
+    int bits = 0;
+    while ((1 << bits) < size) {
+        bits++;
+    }
+
+    for (int i = 0; i < size; i++) {
+        int reversed = 0;
+        for (int b = 0; b < bits; b++) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        m_bit_reverse[i] = reversed;
+    }
+
+    for (int half = 1; half < size; half *= 2) {
+        for (int j = 0; j < half; j++) {
+            double angle = -std::numbers::pi * j / half;
+            m_twiddle_re[half - 1 + j] = std::cos(angle);
+            m_twiddle_im[half - 1 + j] = std::sin(angle);
+        }
+    }
+}
+
+void FftPlan::forward(float* re, float* im) const {
+    for (int i = 0; i < size; i++) {
+        int j = m_bit_reverse[i];
+        if (i < j) {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+
+    for (int half = 1; half < size; half *= 2) {
+        const float* w_re = m_twiddle_re.data() + half - 1;
+        const float* w_im = m_twiddle_im.data() + half - 1;
+
+        for (int start = 0; start < size; start += half * 2) {
+            float* a_re = re + start;
+            float* a_im = im + start;
+            float* b_re = re + start + half;
+            float* b_im = im + start + half;
+
+            int j = 0;
+
+#ifdef SIMD_SSE
+            // first two stages are too narrow for 4 lanes
+            for (; j + 4 <= half; j += 4) {
+                __m128 wr = _mm_loadu_ps(w_re + j);
+                __m128 wi = _mm_loadu_ps(w_im + j);
+                __m128 br = _mm_loadu_ps(b_re + j);
+                __m128 bi = _mm_loadu_ps(b_im + j);
+
+                __m128 tr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+                __m128 ti = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+
+                __m128 ar = _mm_loadu_ps(a_re + j);
+                __m128 ai = _mm_loadu_ps(a_im + j);
+
+                _mm_storeu_ps(b_re + j, _mm_sub_ps(ar, tr));
+                _mm_storeu_ps(b_im + j, _mm_sub_ps(ai, ti));
+                _mm_storeu_ps(a_re + j, _mm_add_ps(ar, tr));
+                _mm_storeu_ps(a_im + j, _mm_add_ps(ai, ti));
+            }
+#endif
+
+            for (; j < half; j++) {
+                float tr = b_re[j] * w_re[j] - b_im[j] * w_im[j];
+                float ti = b_re[j] * w_im[j] + b_im[j] * w_re[j];
+
+                b_re[j] = a_re[j] - tr;
+                b_im[j] = a_im[j] - ti;
+                a_re[j] += tr;
+                a_im[j] += ti;
+            }
+        }
+    }
+}
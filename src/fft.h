@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+
+// in place radix 2 complex fft on split re/im arrays, size must be a power of two
+struct FftPlan {
+    explicit FftPlan(int size);
+
+    void forward(float* re, float* im) const;
+
+    int size;
+
+  private:
+    std::vector<int> m_bit_reverse;
+
+    // stage with butterfly half size h keeps its h twiddles at offset h - 1
+    std::vector<float> m_twiddle_re;
+    std::vector<float> m_twiddle_im;
+};
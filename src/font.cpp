@@ -1,10 +1,24 @@
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <format>
+#include <memory>
 #include <tracy/Tracy.hpp>
+#include <unordered_map>
 #include <vector>
 
 #include "SDL3/SDL_render.h"
 #include "font.h"
+#include "allocator.h"
+#include "damage.h"
+#include "dev_macros.h"
+#include "mapped_file.h"
 
 #define STB_RECT_PACK_IMPLEMENTATION
 #include "stb_rect_pack.h"
@@ -16,154 +30,680 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
-std::vector<char> read_file(const char* file_name) {
-    std::string path = "data/" + std::string(file_name);
-    std::ifstream file{path, std::ios::binary | std::ios::ate};
-    if (!file) {
+namespace Font2 {
+
+// glyph metrics are kept at this pixel height, draw sizes scale from it
+constexpr int baked_font_size = 64;
+
+struct FontFile {
+    // stbtt reads straight out of the mapping
+    MappedFile file;
+    stbtt_fontinfo info;
+    // everything gets rasterized at the baked pixel height
+    float scale;
+};
+
+// searched in order for each codepoint, the first font that has it wins
+// the main font, the nerd font for icons, then whatever is in fallback_fonts_directory
+std::vector<std::unique_ptr<FontFile>> font_chain;
+
+const std::filesystem::path fallback_fonts_directory{"data/fonts"};
+
+bool load_font(const std::filesystem::path& path) {
+    auto font = std::make_unique<FontFile>();
+    if (!font->file.open(path)) {
+        return false;
+    }
+    auto bytes = (const unsigned char*)font->file.data();
+
+    // first face of a collection
+    int offset = stbtt_GetFontOffsetForIndex(bytes, 0);
+    if (offset < 0 || !stbtt_InitFont(&font->info, bytes, offset)) {
+        return false;
+    }
+    font->scale = stbtt_ScaleForPixelHeight(&font->info, baked_font_size);
+
+    font_chain.push_back(std::move(font));
+    return true;
+}
+
+void load_font_chain() {
+    ZoneScoped;
+
+    if (!load_font("data/Avenir LT Std 95 Black.ttf")) {
         exit(1);
     }
+    if (!load_font("data/JetBrainsMonoNLNerdFont-Regular.ttf")) {
+        exit(1);
+    }
+
+    std::error_code error;
+    if (!std::filesystem::is_directory(fallback_fonts_directory, error)) {
+        return;
+    }
 
-    auto size = file.tellg();
-    std::vector<char> data(size, '\0');
-    file.seekg(0);
-    file.read(data.data(), size);
+    std::vector<std::filesystem::path> fallbacks;
+    for (const auto& entry : std::filesystem::directory_iterator(fallback_fonts_directory, error)) {
+        auto extension = entry.path().extension();
+        if (extension == ".ttf" || extension == ".otf" || extension == ".ttc") {
+            fallbacks.push_back(entry.path());
+        }
+    }
+    std::sort(fallbacks.begin(), fallbacks.end());
 
-    return data;
+    for (const auto& path : fallbacks) {
+        if (!load_font(path)) {
+            DEV_LOG(std::format("couldnt load fallback font {}\n", path.string()));
+        }
+    }
 }
 
-namespace Font2 {
+// ascii gets generated once as a signed distance field and cached in sdf_cache_path
+// SDL_Renderer cant run a distance field shader, so at startup the field is resolved into plain
+// coverage at each of text_tiers and text is drawn from the nearest tier at or above its size
+// every tier shares one texture so text still goes out in one geometry call
+constexpr int sdf_padding = 8;
+constexpr unsigned char sdf_on_edge = 128;
+// field value change per pixel of distance
+constexpr float sdf_pixel_dist_scale = 128.0f / sdf_padding;
+constexpr int text_tiers[] = {14, 20, 28, 40, 56, 80, 112};
+constexpr int text_tier_count = std::size(text_tiers);
+constexpr int ascii_first = 32;
+constexpr int ascii_count = 96;
+
+const std::filesystem::path sdf_cache_path{"data/cache/text_sdf"};
+// bump when the cache layout or generation changes
+constexpr uint32_t sdf_cache_version = 1;
+
+// the resolved tiers ready to upload, mapped straight into SDL_UpdateTexture so startup skips the
+// field entirely when nothing changed
+const std::filesystem::path text_atlas_cache_path{"data/cache/text_atlas"};
+constexpr uint32_t text_atlas_cache_version = 2;
 
-struct FontAtlasConfig {
-    int width, height, baked_font_size;
+struct SdfGlyph {
+    // in the field, w and h 0 for glyphs with nothing to draw
+    int x, y, w, h;
+    // field box relative to the pen, at the baked size
+    float xoff, yoff;
+    float xadvance;
 };
 
-constexpr FontAtlasConfig text_font_atlas_config = {
-    512, 512, 64
+struct SdfAtlas {
+    int width, height;
+    std::array<SdfGlyph, ascii_count> glyphs;
+    std::vector<unsigned char> pixels;
 };
 
-constexpr FontAtlasConfig icon_font_atlas_config = {
-    128, 128, 64
+struct TierGlyph {
+    SDL_FRect src;
+    // at the tier size
+    float xoff, yoff;
 };
 
-template <size_t char_count>
-struct FontAtlas {
+struct TextAtlas {
     SDL_Texture* texture;
-    std::array<stbtt_packedchar, char_count> char_data;
+    int width, height;
+    std::array<std::array<TierGlyph, ascii_count>, text_tier_count> tiers;
+    std::array<float, ascii_count> xadvance;
+    // inside of an opaque white block, ui rects are drawn with it so they batch with the text
+    SDL_FRect solid;
 };
 
-using TextFontAtlas = FontAtlas<96>;
-using IconFontAtlas = FontAtlas<4>;
+TextAtlas text_atlas;
+
+uint64_t hash_bytes(uint64_t hash, const void* data, size_t size) {
+    auto bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// fnv-1a of the font plus everything that changes the field
+uint64_t sdf_cache_key(const FontFile& font) {
+    uint64_t hash = hash_bytes(14695981039346656037ull, font.file.data(), font.file.size());
+    const int config[] = {(int)sdf_cache_version, baked_font_size, sdf_padding, sdf_on_edge, ascii_first, ascii_count};
+    return hash_bytes(hash, config, sizeof(config));
+}
+
+// the field key plus the tiers its resolved at
+uint64_t text_atlas_cache_key(uint64_t sdf_key) {
+    const int config[] = {(int)text_atlas_cache_version, text_tier_count};
+    uint64_t hash = hash_bytes(sdf_key, config, sizeof(config));
+    return hash_bytes(hash, text_tiers, sizeof(text_tiers));
+}
+
+// packs rects at a fixed width, doubling the height until everything fits, false past max_height
+bool pack_rects(std::vector<stbrp_rect>& rects, int width, int& height, int max_height) {
+    std::vector<stbrp_node> nodes(width);
+    for (; height <= max_height; height *= 2) {
+        stbrp_context context;
+        stbrp_init_target(&context, width, height, nodes.data(), nodes.size());
+        if (stbrp_pack_rects(&context, rects.data(), rects.size())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// logs and aborts, the copy into the image would run past it otherwise so theres nothing to limp on with
+[[noreturn]] void atlas_overflow(const char* atlas, int width, int max_height) {
+    std::fprintf(stderr, "%s doesnt fit in %dx%d\n", atlas, width, max_height);
+    std::abort();
+}
+
+SdfAtlas generate_sdf_atlas(const FontFile& font) {
+    ZoneScoped;
 
-TextFontAtlas text_font_atlas;
-IconFontAtlas icon_font_atlas;
+    struct Field {
+        unsigned char* data;
+        int w, h, xoff, yoff;
+    };
+    std::array<Field, ascii_count> fields{};
+    std::vector<stbrp_rect> rects(ascii_count);
 
-void generate_text_font_atlas(SDL_Renderer* renderer) {
-    auto& config = text_font_atlas_config;
+    SdfAtlas atlas{};
+    for (int i = 0; i < ascii_count; i++) {
+        int glyph = stbtt_FindGlyphIndex(&font.info, ascii_first + i);
 
-    constexpr auto bitmap_length = config.width * config.height;
-    std::vector<unsigned char> bitmap(bitmap_length);
-    auto& char_data = text_font_atlas.char_data;
+        int advance, left_bearing;
+        stbtt_GetGlyphHMetrics(&font.info, glyph, &advance, &left_bearing);
+        atlas.glyphs[i].xadvance = advance * font.scale;
 
-    auto ttf_buffer = read_file("Avenir LT Std 95 Black.ttf");
-    stbtt_pack_context spc;
-    stbtt_PackBegin(&spc, bitmap.data(), config.width, config.height, 0, 1, nullptr);
-    stbtt_PackFontRange(&spc, (unsigned char*)ttf_buffer.data(), 0, config.baked_font_size, 32, 96, char_data.data());
+        auto& field = fields[i];
+        field.data = stbtt_GetGlyphSDF(&font.info, font.scale, glyph, sdf_padding, sdf_on_edge, sdf_pixel_dist_scale, &field.w, &field.h, &field.xoff, &field.yoff);
+        if (field.data == nullptr) {
+            field.w = 0;
+            field.h = 0;
+        }
 
-    stbtt_PackEnd(&spc);
+        rects[i].id = i;
+        rects[i].w = field.w;
+        rects[i].h = field.h;
+    }
 
-    constexpr int image_size = config.width * config.height * 4;
-    auto image = std::vector<unsigned char>(image_size);
-    for (int i = 0; i < bitmap_length; i++) {
-        image[i * 4] = 255;
-        image[i * 4 + 1] = 255;
-        image[i * 4 + 2] = 255;
-        image[i * 4 + 3] = bitmap[i];
+    atlas.width = 512;
+    atlas.height = 128;
+    if (!pack_rects(rects, atlas.width, atlas.height, 4096)) {
+        atlas_overflow("sdf atlas", atlas.width, 4096);
     }
 
-    auto surface = SDL_CreateSurfaceFrom(config.width, config.height, SDL_PIXELFORMAT_ABGR8888, image.data(), config.width * 4);
-    text_font_atlas.texture = SDL_CreateTextureFromSurface(renderer, surface);
+    atlas.pixels.resize(atlas.width * atlas.height);
+    for (auto& rect : rects) {
+        auto& field = fields[rect.id];
+        auto& glyph = atlas.glyphs[rect.id];
+        glyph.x = rect.x;
+        glyph.y = rect.y;
+        glyph.w = field.w;
+        glyph.h = field.h;
+        glyph.xoff = field.xoff;
+        glyph.yoff = field.yoff;
+
+        for (int row = 0; row < field.h; row++) {
+            std::copy_n(field.data + row * field.w, field.w, atlas.pixels.data() + (rect.y + row) * atlas.width + rect.x);
+        }
+        stbtt_FreeSDF(field.data, nullptr);
+    }
+
+    return atlas;
+}
+
+// header then glyphs then pixels, all native endian, its only ever read back on the same machine
+struct SdfCacheHeader {
+    uint64_t key;
+    int32_t width;
+    int32_t height;
+};
+
+bool load_sdf_cache(uint64_t key, SdfAtlas& atlas) {
+    std::ifstream file{sdf_cache_path, std::ios::binary};
+    if (!file) {
+        return false;
+    }
+
+    SdfCacheHeader header{};
+    file.read((char*)&header, sizeof(header));
+    if (!file || header.key != key || header.width <= 0 || header.height <= 0) {
+        return false;
+    }
+
+    atlas.width = header.width;
+    atlas.height = header.height;
+    file.read((char*)atlas.glyphs.data(), sizeof(atlas.glyphs));
+    atlas.pixels.resize((size_t)atlas.width * atlas.height);
+    file.read((char*)atlas.pixels.data(), atlas.pixels.size());
+
+    return (bool)file;
+}
+
+void save_sdf_cache(uint64_t key, const SdfAtlas& atlas) {
+    std::error_code error;
+    std::filesystem::create_directories(sdf_cache_path.parent_path(), error);
+
+    std::ofstream file{sdf_cache_path, std::ios::binary};
+    SdfCacheHeader header{key, atlas.width, atlas.height};
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)atlas.glyphs.data(), sizeof(atlas.glyphs));
+    file.write((const char*)atlas.pixels.data(), atlas.pixels.size());
 }
 
-stbtt_fontinfo icon_font_info;
+float sample_field(const SdfAtlas& atlas, const SdfGlyph& glyph, float x, float y) {
+    x = std::clamp(x - 0.5f, 0.0f, (float)glyph.w - 1);
+    y = std::clamp(y - 0.5f, 0.0f, (float)glyph.h - 1);
+    int x0 = (int)x;
+    int y0 = (int)y;
+    int x1 = std::min(x0 + 1, glyph.w - 1);
+    int y1 = std::min(y0 + 1, glyph.h - 1);
+    float fx = x - x0;
+    float fy = y - y0;
 
-std::vector<int32_t> icons = {
-    U'󰒫',
-    U'󰒬',
-    U'󰐊',
-    U'󰏤',
+    auto at = [&](int px, int py) {
+        return (float)atlas.pixels[(glyph.y + py) * atlas.width + glyph.x + px];
+    };
+    float top = at(x0, y0) + (at(x1, y0) - at(x0, y0)) * fx;
+    float bottom = at(x0, y1) + (at(x1, y1) - at(x0, y1)) * fx;
+    return top + (bottom - top) * fy;
+}
+
+// resolves the field at every tier size into text_atlas's tables and the returned rgba image
+std::vector<unsigned char> resolve_text_atlas(const SdfAtlas& sdf) {
+    ZoneScoped;
+
+    // field padding is mostly empty, tiers keep one pixel of it for the edge ramp
+    std::vector<stbrp_rect> rects;
+    rects.reserve(text_tier_count * ascii_count);
+    for (int tier = 0; tier < text_tier_count; tier++) {
+        float ratio = (float)text_tiers[tier] / baked_font_size;
+        for (int i = 0; i < ascii_count; i++) {
+            auto& glyph = sdf.glyphs[i];
+            stbrp_rect rect{};
+            rect.id = tier * ascii_count + i;
+            if (glyph.w > 0 && glyph.h > 0) {
+                rect.w = (int)std::ceil((glyph.w - 2 * sdf_padding) * ratio) + 2;
+                rect.h = (int)std::ceil((glyph.h - 2 * sdf_padding) * ratio) + 2;
+            }
+            rects.push_back(rect);
+        }
+    }
+
+    // the solid block, a pixel of margin each side so filtering never reaches the edge
+    constexpr int solid_id = text_tier_count * ascii_count;
+    stbrp_rect solid_rect{};
+    solid_rect.id = solid_id;
+    solid_rect.w = 4;
+    solid_rect.h = 4;
+    rects.push_back(solid_rect);
+
+    text_atlas.width = 1024;
+    text_atlas.height = 256;
+    if (!pack_rects(rects, text_atlas.width, text_atlas.height, 4096)) {
+        atlas_overflow("text atlas", text_atlas.width, 4096);
+    }
+
+    std::vector<unsigned char> image((size_t)text_atlas.width * text_atlas.height * 4);
+    for (auto& rect : rects) {
+        if (rect.id == solid_id) {
+            for (int row = 0; row < rect.h; row++) {
+                std::memset(image.data() + ((size_t)(rect.y + row) * text_atlas.width + rect.x) * 4, 255, (size_t)rect.w * 4);
+            }
+            text_atlas.solid = {(float)rect.x + 1, (float)rect.y + 1, (float)rect.w - 2, (float)rect.h - 2};
+            continue;
+        }
+
+        int tier = rect.id / ascii_count;
+        int i = rect.id % ascii_count;
+        auto& glyph = sdf.glyphs[i];
+        float ratio = (float)text_tiers[tier] / baked_font_size;
+
+        auto& out = text_atlas.tiers[tier][i];
+        out.src = {(float)rect.x, (float)rect.y, (float)rect.w, (float)rect.h};
+        out.xoff = (glyph.xoff + sdf_padding) * ratio - 1;
+        out.yoff = (glyph.yoff + sdf_padding) * ratio - 1;
+
+        // one tier pixel is 1 / ratio field pixels, ramp coverage over one tier pixel around the edge
+        float value_per_pixel = sdf_pixel_dist_scale / ratio;
+        for (int row = 0; row < rect.h; row++) {
+            for (int column = 0; column < rect.w; column++) {
+                float x = sdf_padding + (column - 1 + 0.5f) / ratio;
+                float y = sdf_padding + (row - 1 + 0.5f) / ratio;
+                float value = sample_field(sdf, glyph, x, y);
+                float coverage = std::clamp(0.5f + (value - sdf_on_edge) / value_per_pixel, 0.0f, 1.0f);
+
+                auto pixel = image.data() + ((size_t)(rect.y + row) * text_atlas.width + rect.x + column) * 4;
+                pixel[0] = 255;
+                pixel[1] = 255;
+                pixel[2] = 255;
+                pixel[3] = (unsigned char)(coverage * 255 + 0.5f);
+            }
+        }
+    }
+
+    for (int i = 0; i < ascii_count; i++) {
+        text_atlas.xadvance[i] = sdf.glyphs[i].xadvance;
+    }
+
+    return image;
+}
+
+void upload_text_atlas(SDL_Renderer* renderer, const void* pixels) {
+    text_atlas.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STATIC, text_atlas.width, text_atlas.height);
+    SDL_SetTextureBlendMode(text_atlas.texture, SDL_BLENDMODE_BLEND);
+    SDL_UpdateTexture(text_atlas.texture, nullptr, pixels, text_atlas.width * 4);
+}
+
+struct TextAtlasCacheHeader {
+    uint64_t key;
+    int32_t width;
+    int32_t height;
 };
 
-void generate_icon_font_atlas(SDL_Renderer* renderer) {
-    auto& config = icon_font_atlas_config;
+// tables get copied out, the pixels stay in the mapping, false if its missing or stale
+bool load_text_atlas_cache(uint64_t key, MappedFile& file, const unsigned char*& pixels) {
+    if (!file.open(text_atlas_cache_path) || file.size() < sizeof(TextAtlasCacheHeader)) {
+        return false;
+    }
 
-    constexpr auto bitmap_length = config.width * config.height;
-    std::vector<unsigned char> bitmap(bitmap_length);
+    TextAtlasCacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.key != key || header.width <= 0 || header.height <= 0) {
+        return false;
+    }
 
-    auto ttf_buffer = read_file("JetBrainsMonoNLNerdFont-Regular.ttf");
-    stbtt_InitFont(&icon_font_info, (unsigned char*)ttf_buffer.data(), 0);
-    stbtt_pack_context spc;
-    stbtt_PackBegin(&spc, bitmap.data(), config.width, config.height, 0, 1, nullptr);
+    const size_t tables_size = sizeof(text_atlas.tiers) + sizeof(text_atlas.xadvance) + sizeof(text_atlas.solid);
+    const size_t pixels_size = (size_t)header.width * header.height * 4;
+    if (file.size() != sizeof(header) + tables_size + pixels_size) {
+        return false;
+    }
 
-    stbtt_pack_range range{};
-    range.font_size = config.baked_font_size;
-    range.array_of_unicode_codepoints = icons.data();
-    range.num_chars = icons.size();
-    range.chardata_for_range = icon_font_atlas.char_data.data();
+    auto at = file.data() + sizeof(header);
+    std::memcpy(text_atlas.tiers.data(), at, sizeof(text_atlas.tiers));
+    at += sizeof(text_atlas.tiers);
+    std::memcpy(text_atlas.xadvance.data(), at, sizeof(text_atlas.xadvance));
+    at += sizeof(text_atlas.xadvance);
+    std::memcpy(&text_atlas.solid, at, sizeof(text_atlas.solid));
+    at += sizeof(text_atlas.solid);
 
+    text_atlas.width = header.width;
+    text_atlas.height = header.height;
+    pixels = (const unsigned char*)at;
+    return true;
+}
 
-    stbtt_PackFontRanges(&spc, (unsigned char*)ttf_buffer.data(), 0, &range, 1);
+void save_text_atlas_cache(uint64_t key, const std::vector<unsigned char>& image) {
+    std::error_code error;
+    std::filesystem::create_directories(text_atlas_cache_path.parent_path(), error);
 
-    stbtt_PackEnd(&spc);
+    std::ofstream file{text_atlas_cache_path, std::ios::binary};
+    TextAtlasCacheHeader header{key, text_atlas.width, text_atlas.height};
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)text_atlas.tiers.data(), sizeof(text_atlas.tiers));
+    file.write((const char*)text_atlas.xadvance.data(), sizeof(text_atlas.xadvance));
+    file.write((const char*)&text_atlas.solid, sizeof(text_atlas.solid));
+    file.write((const char*)image.data(), image.size());
+}
+
+// fills text_atlas's tables and returns the pixels, straight out of the mapped cache when its current,
+// otherwise resolved into image. file and image have to outlive the returned pointer
+const unsigned char* load_text_atlas(MappedFile& file, std::vector<unsigned char>& image) {
+    ZoneScoped;
 
-    constexpr int image_size = config.width * config.height * 4;
-    auto image = std::vector<unsigned char>(image_size);
-    for (int i = 0; i < bitmap_length; i++) {
-        image[i * 4] = 255;
-        image[i * 4 + 1] = 255;
-        image[i * 4 + 2] = 255;
-        image[i * 4 + 3] = bitmap[i];
+    auto& font = *font_chain[0];
+    uint64_t sdf_key = sdf_cache_key(font);
+    uint64_t atlas_key = text_atlas_cache_key(sdf_key);
+
+    const unsigned char* pixels;
+    if (load_text_atlas_cache(atlas_key, file, pixels)) {
+        DEV_LOG(std::format("text atlas: {}x{} mapped from cache\n", text_atlas.width, text_atlas.height));
+        return pixels;
+    }
+
+    SdfAtlas sdf{};
+    bool cached = load_sdf_cache(sdf_key, sdf);
+    if (!cached) {
+        sdf = generate_sdf_atlas(font);
+        save_sdf_cache(sdf_key, sdf);
     }
 
+    image = resolve_text_atlas(sdf);
+    save_text_atlas_cache(atlas_key, image);
+
+    // the time each step took is in the tracy zones
+    DEV_LOG(std::format("text atlas: field {}x{} {} ({} KiB), tiers {}x{} ({} KiB)\n",
+        sdf.width, sdf.height, cached ? "from cache" : "generated", sdf.pixels.size() / 1024,
+        text_atlas.width, text_atlas.height, image.size() / 1024));
 
+    return image.data();
+}
 
-    auto surface = SDL_CreateSurfaceFrom(config.width, config.height, SDL_PIXELFORMAT_ABGR8888, image.data(), config.width * 4);
-    icon_font_atlas.texture = SDL_CreateTextureFromSurface(renderer, surface);
+void generate_text_atlas(SDL_Renderer* renderer) {
+    MappedFile file;
+    std::vector<unsigned char> image;
+    upload_text_atlas(renderer, load_text_atlas(file, image));
 }
 
-stbtt_packedchar get_icon_char_info(int32_t codepoint) {
-    for (int i = 0; i < icons.size(); i++) {
-        if(icons[i] == codepoint) {
-            return icon_font_atlas.char_data[i];
+// tier to draw a size from, the smallest one at least as big so its only ever scaled down
+int text_tier(float font_size) {
+    for (int i = 0; i < text_tier_count; i++) {
+        if (text_tiers[i] >= font_size) {
+            return i;
         }
     }
-
-    return {};
+    return text_tier_count - 1;
 }
 
-// void save_font_atlas_image() {
-//     auto [image, char_data] = generate_text_font_atlas();
-//     auto& config = text_font_atlas_config;
-//
-//     stbi_write_png("font_atlas.png", config.width, config.height, 4, image.data(), 4 * config.width);
-// }
-//
-// void save_icons() {
-//     auto [image, char_data] = generate_icon_font_atlas();
-//     auto& config = icon_font_atlas_config;
-//
-//     stbi_write_png("icons.png", config.width, config.height, 4, image.data(), 4 * config.width);
-// }
+// glyph quads waiting on one atlas, vertex colored so strings with different colors still share a draw
+// the vectors keep their capacity between flushes
+struct GlyphBatch {
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+
+    void add_quad(const SDL_FRect& src, const SDL_FRect& dst, SDL_FColor color, float atlas_width, float atlas_height) {
+        int first = (int)vertices.size();
+
+        float u0 = src.x / atlas_width;
+        float v0 = src.y / atlas_height;
+        float u1 = (src.x + src.w) / atlas_width;
+        float v1 = (src.y + src.h) / atlas_height;
+
+        vertices.push_back({{dst.x, dst.y}, color, {u0, v0}});
+        vertices.push_back({{dst.x + dst.w, dst.y}, color, {u1, v0}});
+        vertices.push_back({{dst.x + dst.w, dst.y + dst.h}, color, {u1, v1}});
+        vertices.push_back({{dst.x, dst.y + dst.h}, color, {u0, v1}});
+
+        const int quad[] = {0, 1, 2, 0, 2, 3};
+        for (int i : quad) {
+            indices.push_back(first + i);
+        }
+    }
+
+    int flush(SDL_Renderer* renderer, SDL_Texture* texture) {
+        if (vertices.empty()) {
+            return 0;
+        }
+
+        SDL_RenderGeometry(renderer, texture, vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size());
+        vertices.clear();
+        indices.clear();
+        return 1;
+    }
+};
+
+GlyphBatch text_batch;
+
+// bumped by end_frame, for the lru bookkeeping in here
+uint32_t current_frame = 1;
 
-void init_main_font(SDL_Renderer *renderer){}
+// everything outside the baked ascii range gets rasterized into pages the first time its drawn
+// when they fill up the page drawn from longest ago is cleared and its glyphs rasterized again on demand
+constexpr int glyph_page_size = 1024;
+constexpr int glyph_page_count = 4;
+// clear border around each glyph so filtering never picks up a neighbour
+constexpr int glyph_padding = 1;
+// new glyphs rasterized per frame, a screen full of new titles fills in over a few frames instead of hitching
+constexpr int glyph_raster_budget = 16;
 
-enum class Font {
-    Text,
-    Icon,
+struct Glyph {
+    // index into font_chain, -1 if no font has it
+    int font;
+    // glyph index within that font
+    int index;
+    // -1 until rasterized
+    int page;
+    SDL_FRect src;
+    // at the baked size
+    float xoff, yoff, width, height, xadvance;
 };
 
+struct GlyphPage {
+    SDL_Texture* texture;
+    stbrp_context packer;
+    std::array<stbrp_node, glyph_page_size> nodes;
+    std::vector<int32_t> codepoints;
+    uint32_t last_used;
+    GlyphBatch batch;
+};
+
+// metrics for every codepoint seen so far, those stay even when the page gets recycled
+std::unordered_map<int32_t, Glyph> glyphs;
+std::array<GlyphPage, glyph_page_count> glyph_pages;
+int glyphs_rasterized = 0;
+int glyphs_deferred = 0;
+
+void init_glyph_pages(SDL_Renderer* renderer) {
+    ZoneScoped;
+
+    for (auto& page : glyph_pages) {
+        page.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STATIC, glyph_page_size, glyph_page_size);
+        SDL_SetTextureBlendMode(page.texture, SDL_BLENDMODE_BLEND);
+        stbrp_init_target(&page.packer, glyph_page_size, glyph_page_size, page.nodes.data(), page.nodes.size());
+    }
+    glyphs.reserve(4096);
+}
+
+// metrics only, cheap enough for measuring
+Glyph& find_glyph(int32_t codepoint) {
+    auto it = glyphs.find(codepoint);
+    if (it != glyphs.end()) {
+        return it->second;
+    }
+
+    Glyph glyph{-1, 0, -1};
+    for (int i = 0; i < font_chain.size(); i++) {
+        glyph.index = stbtt_FindGlyphIndex(&font_chain[i]->info, codepoint);
+        if (glyph.index != 0) {
+            glyph.font = i;
+            break;
+        }
+    }
+
+    if (glyph.font >= 0) {
+        auto& font = *font_chain[glyph.font];
+
+        int advance, left_bearing;
+        stbtt_GetGlyphHMetrics(&font.info, glyph.index, &advance, &left_bearing);
+        int x0, y0, x1, y1;
+        stbtt_GetGlyphBitmapBox(&font.info, glyph.index, font.scale, font.scale, &x0, &y0, &x1, &y1);
+
+        glyph.xoff = x0;
+        glyph.yoff = y0;
+        glyph.width = x1 - x0;
+        glyph.height = y1 - y0;
+        glyph.xadvance = advance * font.scale;
+    }
+
+    return glyphs.emplace(codepoint, glyph).first->second;
+}
+
+// the page drawn from longest ago, -1 if every page has been drawn from this frame
+// a page not drawn from this frame has an empty batch so nothing queued can point into it
+int recycle_glyph_page() {
+    int oldest = -1;
+    for (int i = 0; i < glyph_page_count; i++) {
+        if (glyph_pages[i].last_used != current_frame && (oldest < 0 || glyph_pages[i].last_used < glyph_pages[oldest].last_used)) {
+            oldest = i;
+        }
+    }
+    if (oldest < 0) {
+        return -1;
+    }
+
+    auto& page = glyph_pages[oldest];
+    for (int32_t codepoint : page.codepoints) {
+        glyphs[codepoint].page = -1;
+    }
+    page.codepoints.clear();
+    stbrp_init_target(&page.packer, glyph_page_size, glyph_page_size, page.nodes.data(), page.nodes.size());
+
+    return oldest;
+}
+
+bool rasterize_glyph(int32_t codepoint, Glyph& glyph) {
+    ZoneScoped;
+
+    int width = (int)glyph.width + glyph_padding * 2;
+    int height = (int)glyph.height + glyph_padding * 2;
+
+    stbrp_rect rect{};
+    rect.w = width;
+    rect.h = height;
+
+    int page_index = -1;
+    for (int i = 0; i < glyph_page_count; i++) {
+        if (stbrp_pack_rects(&glyph_pages[i].packer, &rect, 1) && rect.was_packed) {
+            page_index = i;
+            break;
+        }
+    }
+    if (page_index < 0) {
+        page_index = recycle_glyph_page();
+        if (page_index < 0 || !stbrp_pack_rects(&glyph_pages[page_index].packer, &rect, 1) || !rect.was_packed) {
+            return false;
+        }
+    }
+
+    auto& font = *font_chain[glyph.font];
+    auto& page = glyph_pages[page_index];
+
+    ScratchScope scratch;
+    auto coverage = (unsigned char*)scratch.arena.allocate(width * height, 1);
+    std::fill(coverage, coverage + width * height, 0);
+    stbtt_MakeGlyphBitmap(&font.info, coverage + glyph_padding * width + glyph_padding, (int)glyph.width, (int)glyph.height, width, font.scale, font.scale, glyph.index);
+
+    auto pixels = (unsigned char*)scratch.arena.allocate(width * height * 4, 4);
+    for (int i = 0; i < width * height; i++) {
+        pixels[i * 4] = 255;
+        pixels[i * 4 + 1] = 255;
+        pixels[i * 4 + 2] = 255;
+        pixels[i * 4 + 3] = coverage[i];
+    }
+
+    SDL_Rect dst{rect.x, rect.y, width, height};
+    SDL_UpdateTexture(page.texture, &dst, pixels, width * 4);
+
+    glyph.page = page_index;
+    glyph.src = {(float)(rect.x + glyph_padding), (float)(rect.y + glyph_padding), glyph.width, glyph.height};
+    page.codepoints.push_back(codepoint);
+
+    return true;
+}
+
 void init_fonts(SDL_Renderer* renderer) {
-    generate_text_font_atlas(renderer);
-    generate_icon_font_atlas(renderer);
+    ZoneScoped;
+
+    load_font_chain();
+    generate_text_atlas(renderer);
+    init_glyph_pages(renderer);
+}
+
+void init_font_metrics() {
+    ZoneScoped;
+
+    load_font_chain();
+    MappedFile file;
+    std::vector<unsigned char> image;
+    load_text_atlas(file, image);
+    glyphs.reserve(4096);
 }
 
 int utf8decode_unsafe(const char *s, int32_t *c)
@@ -208,6 +748,32 @@ int utf8decode_unsafe(const char *s, int32_t *c)
     return 1;
 }
 
+void draw_glyph(int32_t codepoint, Glyph& glyph, Vec2 position, float font_size, float size_ratio, SDL_FColor color) {
+    if (glyph.width == 0 || glyph.height == 0) {
+        return;
+    }
+
+    if (glyph.page < 0) {
+        // over budget, it gets its turn next frame
+        if (glyphs_rasterized >= glyph_raster_budget) {
+            glyphs_deferred++;
+            return;
+        }
+        glyphs_rasterized++;
+        if (!rasterize_glyph(codepoint, glyph)) {
+            return;
+        }
+    }
+
+    auto& page = glyph_pages[glyph.page];
+    page.last_used = current_frame;
+
+    auto dst = SDL_FRect{
+        position.x + glyph.xoff * size_ratio, font_size + position.y + glyph.yoff * size_ratio, glyph.width * size_ratio, glyph.height * size_ratio
+    };
+    page.batch.add_quad(glyph.src, dst, color, glyph_page_size, glyph_page_size);
+}
+
 void draw_text(SDL_Renderer* renderer, const char* text, float font_size, Vec2 position, RGBA color, float max_width) {
     ZoneScoped;
 
@@ -215,70 +781,259 @@ void draw_text(SDL_Renderer* renderer, const char* text, float font_size, Vec2 p
         return;
     }
 
-    SDL_SetTextureColorMod(text_font_atlas.texture, color.r, color.g, color.b);
-    SDL_SetTextureAlphaMod(text_font_atlas.texture, color.a);
-    SDL_SetTextureColorMod(icon_font_atlas.texture, color.r, color.g, color.b);
-    SDL_SetTextureAlphaMod(icon_font_atlas.texture, color.a);
+    const SDL_FColor vertex_color = {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f};
+
+    float size_ratio = font_size / baked_font_size;
 
-    float size_ratio = font_size / text_font_atlas_config.baked_font_size;
+    int tier = text_tier(font_size);
+    auto& tier_glyphs = text_atlas.tiers[tier];
+    float tier_ratio = font_size / text_tiers[tier];
 
     float x = position.x;
     while (*text && x - position.x <= max_width) {
         int32_t c;
         auto bytes_skip = utf8decode_unsafe(text, &c);
+        text += bytes_skip;
+
         if (c == '\n') {
             position.y += font_size;
             x = position.x;
-        } else {
-            auto texture = (c > 127) ? icon_font_atlas.texture : text_font_atlas.texture;
-            stbtt_packedchar char_info = (c > 127) ? get_icon_char_info(c) : text_font_atlas.char_data[c - 32];
+            continue;
+        }
 
+        if (c < 32 || c > 127) {
+            Glyph& glyph = find_glyph(c);
+            if (glyph.font >= 0) {
+                draw_glyph(c, glyph, {x, position.y}, font_size, size_ratio, vertex_color);
+                x += glyph.xadvance * size_ratio;
+                continue;
+            }
+            // nothing has it, a ? at least shows something is there
+            c = '?';
+        }
 
-            float w = char_info.x1 - char_info.x0;
-            float h = char_info.y1 - char_info.y0;
-            auto src = SDL_FRect{(float)char_info.x0, (float)char_info.y0, w, h};
+        auto& glyph = tier_glyphs[c - ascii_first];
+        if (glyph.src.w > 0) {
             auto dst = SDL_FRect{
-                x + char_info.xoff * size_ratio, font_size + position.y + char_info.yoff * size_ratio, w * size_ratio, h * size_ratio
+                x + glyph.xoff * tier_ratio, font_size + position.y + glyph.yoff * tier_ratio, glyph.src.w * tier_ratio, glyph.src.h * tier_ratio
             };
-
-            SDL_RenderTexture(renderer, texture, &src, &dst);
-            x += char_info.xadvance * size_ratio;
+            text_batch.add_quad(glyph.src, dst, vertex_color, text_atlas.width, text_atlas.height);
         }
+        x += text_atlas.xadvance[c - ascii_first] * size_ratio;
+    }
+}
 
-        text += bytes_skip;
+int flush_text(SDL_Renderer* renderer) {
+    ZoneScoped;
+
+    int draw_calls = text_batch.flush(renderer, text_atlas.texture);
+    for (auto& page : glyph_pages) {
+        draw_calls += page.batch.flush(renderer, page.texture);
     }
+    return draw_calls;
 }
 
-Vec2 text_dimensions(const char* text, float font_size) {
-    float max_width = 0;
-    float width = 0;
+int draw_rect(SDL_Renderer* renderer, const SDL_FRect& rect, RGBA fill, RGBA border) {
+    // glyph pages go out after the main batch, anything waiting there has to be drawn now or it
+    // would end up over this rect
+    int draw_calls = 0;
+    for (auto& page : glyph_pages) {
+        if (!page.batch.vertices.empty()) {
+            draw_calls = flush_text(renderer);
+            break;
+        }
+    }
 
-    if (text == nullptr) {
-        return {};
+    auto& solid = text_atlas.solid;
+    float width = (float)text_atlas.width;
+    float height = (float)text_atlas.height;
+
+    if (fill.a > 0) {
+        const SDL_FColor color = {fill.r / 255.0f, fill.g / 255.0f, fill.b / 255.0f, fill.a / 255.0f};
+        text_batch.add_quad(solid, rect, color, width, height);
+    }
+
+    if (border.a > 0) {
+        // same pixels the old line strip covered, the corners at x + w and y + h included
+        const SDL_FColor color = {border.r / 255.0f, border.g / 255.0f, border.b / 255.0f, border.a / 255.0f};
+        text_batch.add_quad(solid, {rect.x, rect.y, rect.w + 1, 1}, color, width, height);
+        text_batch.add_quad(solid, {rect.x, rect.y + rect.h, rect.w + 1, 1}, color, width, height);
+        text_batch.add_quad(solid, {rect.x, rect.y + 1, 1, rect.h - 1}, color, width, height);
+        text_batch.add_quad(solid, {rect.x + rect.w, rect.y + 1, 1, rect.h - 1}, color, width, height);
     }
 
-    float size_ratio = font_size / text_font_atlas_config.baked_font_size;
+    return draw_calls;
+}
+
+// width at the baked size and line count, scaling is linear so any font size can reuse it
+struct TextMeasure {
+    float width;
+    int lines;
+};
 
+TextMeasure measure_text(const char* text) {
+    float max_width = 0;
+    float width = 0;
     int lines = 1;
 
     while (*text) {
         int32_t c;
         auto bytes_skip = utf8decode_unsafe(text, &c);
+        text += bytes_skip;
+
         if (c == '\n') {
             max_width = std::max(max_width, width);
             width = 0;
             lines++;
-        } else {
-            stbtt_packedchar char_info = (c > 127) ? get_icon_char_info(c) : text_font_atlas.char_data[c - 32];
+            continue;
+        }
 
-            width += char_info.xadvance;
+        if (c < 32 || c > 127) {
+            const Glyph& glyph = find_glyph(c);
+            if (glyph.font >= 0) {
+                width += glyph.xadvance;
+                continue;
+            }
+            c = '?';
         }
 
-        text += bytes_skip;
+        width += text_atlas.xadvance[c - ascii_first];
     }
     max_width = std::max(max_width, width);
 
-    return {max_width * size_ratio, lines * font_size};
+    return {max_width, lines};
+}
+
+// measurements keyed by content, open addressed so lookups never allocate
+// entries not asked for in measure_cache_max_age frames are dropped when it fills up
+// render thread only
+struct MeasureEntry {
+    // 0 is an empty slot
+    uint64_t hash;
+    uint32_t length;
+    uint32_t last_used;
+    TextMeasure measure;
+};
+
+constexpr size_t measure_cache_capacity = 16384;
+constexpr size_t measure_cache_max_load = measure_cache_capacity / 4 * 3;
+constexpr uint32_t measure_cache_max_age = 300;
+static_assert((measure_cache_capacity & (measure_cache_capacity - 1)) == 0);
+
+std::vector<MeasureEntry> measure_cache;
+size_t measure_cache_count = 0;
+// set when even this frame's strings fill the table, misses skip the cache until end_frame
+// instead of rebuilding it twice per miss
+bool measure_cache_full = false;
+int64_t measure_hits = 0;
+int64_t measure_misses = 0;
+
+// fnv-1a, also counts the bytes so a collision has to match length too
+uint64_t hash_text(const char* text, uint32_t& length) {
+    uint64_t hash = 14695981039346656037ull;
+    const char* start = text;
+    while (*text) {
+        hash ^= (uint8_t)*text;
+        hash *= 1099511628211ull;
+        text++;
+    }
+    length = (uint32_t)(text - start);
+
+    return hash | 1;
+}
+
+MeasureEntry* find_slot(uint64_t hash, uint32_t length) {
+    const size_t mask = measure_cache_capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        auto& entry = measure_cache[i];
+        if (entry.hash == 0 || (entry.hash == hash && entry.length == length)) {
+            return &entry;
+        }
+    }
+}
+
+// rebuilds the table with only the entries used in the last max_age frames
+void evict_measures(uint32_t max_age) {
+    ZoneScoped;
+
+    ScratchScope scratch;
+    temp::vector<MeasureEntry> kept(scratch.arena);
+    kept.reserve(measure_cache_count);
+    for (auto& entry : measure_cache) {
+        if (entry.hash != 0 && current_frame - entry.last_used <= max_age) {
+            kept.push_back(entry);
+        }
+    }
+
+    std::fill(measure_cache.begin(), measure_cache.end(), MeasureEntry{});
+    for (auto& entry : kept) {
+        *find_slot(entry.hash, entry.length) = entry;
+    }
+    measure_cache_count = kept.size();
+}
+
+Vec2 text_dimensions(const char* text, float font_size) {
+    if (text == nullptr) {
+        return {};
+    }
+
+    if (measure_cache.empty()) {
+        measure_cache.resize(measure_cache_capacity);
+    }
+
+    float size_ratio = font_size / baked_font_size;
+
+    uint32_t length;
+    uint64_t hash = hash_text(text, length);
+    MeasureEntry* entry = find_slot(hash, length);
+
+    if (entry->hash == 0) {
+        if (measure_cache_count >= measure_cache_max_load && !measure_cache_full) {
+            evict_measures(measure_cache_max_age);
+            // everything is still in use, keep only this frame's
+            if (measure_cache_count >= measure_cache_max_load) {
+                evict_measures(0);
+                measure_cache_full = measure_cache_count >= measure_cache_max_load;
+            }
+            entry = find_slot(hash, length);
+        }
+
+        auto measure = measure_text(text);
+        measure_misses++;
+
+        if (measure_cache_count >= measure_cache_max_load) {
+            return {measure.width * size_ratio, measure.lines * font_size};
+        }
+
+        *entry = {hash, length, current_frame, measure};
+        measure_cache_count++;
+    } else {
+        measure_hits++;
+        entry->last_used = current_frame;
+    }
+
+    return {entry->measure.width * size_ratio, entry->measure.lines * font_size};
+}
+
+void end_frame() {
+    TracyPlot("text measure hits", measure_hits);
+    TracyPlot("text measure misses", measure_misses);
+    TracyPlot("text measure entries", (int64_t)measure_cache_count);
+    TracyPlot("glyphs rasterized", (int64_t)glyphs_rasterized);
+    TracyPlot("glyphs deferred", (int64_t)glyphs_deferred);
+    TracyPlot("glyphs known", (int64_t)glyphs.size());
+    // those glyphs are missing from what was drawn, the screens that skip unchanged frames
+    // have to come back for them
+    if (glyphs_deferred > 0) {
+        damage::invalidate_next_frame();
+    }
+
+    measure_hits = 0;
+    measure_misses = 0;
+    measure_cache_full = false;
+    glyphs_rasterized = 0;
+    glyphs_deferred = 0;
+    current_frame++;
 }
 
 float text_height(const char* text, float font_size) {
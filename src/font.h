@@ -19,10 +19,21 @@
 
 namespace Font2 {
     void init_fonts(SDL_Renderer* renderer);
+    // fonts and the atlas tables without any textures, enough for text_dimensions with no renderer
+    void init_font_metrics();
+    // only queues the glyphs, nothing shows up until flush_text
     void draw_text(SDL_Renderer* renderer, const char* text, float font_size, Vec2 position, RGBA color, float max_width);
+    // draws everything queued since the last flush, one geometry call per atlas, returns the calls made
+    int flush_text(SDL_Renderer* renderer);
+    // queues a filled box with a one pixel border into the text batch so rects and text keep their
+    // order in the same geometry call, returns the calls made if queued glyphs had to go out first
+    int draw_rect(SDL_Renderer* renderer, const SDL_FRect& rect, RGBA fill, RGBA border);
     Vec2 text_dimensions(const char* text, float font_size);
     float text_height(const char* text, float font_size);
 
+    // ages the text measurement cache, once a frame after everything has been laid out
+    void end_frame();
+
     //
     // void save_font_atlas_image();
     // void save_icons();
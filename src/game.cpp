@@ -6,18 +6,26 @@
 #include "SDL3_mixer/SDL_mixer.h"
 #include "constants.h"
 #include "assets.h"
+#include "dev_macros.h"
 #include "events.h"
 #include "input.h"
+#include "loudness.h"
 #include "map.h"
+#include "mem_tags.h"
 #include "serialize.h"
 #include "ui.h"
 #include "vec.h"
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <span>
 #include <tracy/Tracy.hpp>
 
 using namespace std::chrono_literals;
 
 constexpr double input_indicator_duration = 0.1;
+// old inputs get dropped once this fills
+constexpr size_t input_history_capacity = 1024;
 constexpr std::chrono::duration<float> end_screen_delay = 1s;
 
 using namespace constants;
@@ -139,6 +147,7 @@ Game::Game(Systems systems, game::InitConfig config) :
     audio{ systems.audio },
     assets{ systems.assets },
     event_queue{ systems.event_queue },
+    settings{ systems.settings },
     m_auto_mode{ config.auto_mode },
     m_test_mode{ config.test_mode },
     config{config}
@@ -149,23 +158,57 @@ const static double min_buffer_duration = 1;
 void Game::start() {
     load_binary(m_map, config.mapset_directory / config.map_filename);
     note_alive_list = std::vector<bool>(m_map.times.size(), true);
+
+    // every note can add at most one of each, so none of these grow mid play
+    m_hit_errors.reserve(m_map.times.size());
+    in_flight_notes.times.reserve(m_map.times.size());
+    in_flight_notes.flags.reserve(m_map.times.size());
+    m_miss_effects.reserve(m_map.times.size());
+    input_history.reserve(input_history_capacity);
+
+    MapSetInfo mapset_info{};
+    load_binary(mapset_info, config.mapset_directory / constants::mapset_filename);
+    audio.set_music_gain(loudness_gain(mapset_info));
+
     auto music_file = find_music_file(config.mapset_directory);
     if (music_file.has_value()) {
-        audio.load_music(music_file.value().string().data());
+        audio.stop();
+        m_music_load = load_music_async(music_file.value());
+        m_view = View::loading;
+    } else {
+        m_view = View::main;
+        begin_playback();
     }
-    // audio.resume();
-    if (m_map.times[current_note_index] < min_buffer_duration)  {
+
+    SDL_HideCursor();
+}
+
+void Game::begin_playback() {
+    if (m_map.times.size() > 0 && m_map.times[current_note_index] < min_buffer_duration)  {
         m_buffer_elapsed = m_map.times[current_note_index] - min_buffer_duration;
 
     } else {
         audio.play(0);
         m_audio_started = true;
     }
-
-    SDL_HideCursor();
 }
 
 
+// hits from real plays keep the calibration honest
+void Game::finish_play() {
+    m_hit_stats = hit_error_stats(m_hit_errors);
+
+    if (m_auto_mode) {
+        return;
+    }
+
+    auto residual = estimate_offset(m_hit_errors);
+    if (residual.has_value()) {
+        refine_offset(settings, residual.value());
+        save_settings(settings);
+    }
+}
+
 void Game::update(std::chrono::duration<double> delta_time) {
     ZoneScoped;
     if (!initialized) {
@@ -173,6 +216,35 @@ void Game::update(std::chrono::duration<double> delta_time) {
         initialized = true;
     }
 
+    if (m_view == View::loading) {
+        if (music_loaded(m_music_load)) {
+            int result = audio.use_music(m_music_load);
+            m_music_load.reset();
+
+            if (result != 0) {
+                // song wouldnt open, nothing to play along to so back out
+                DEV_LOG("couldnt open music, leaving the map\n");
+                SDL_ShowCursor();
+                if (m_test_mode) {
+                    event_queue.push_event(Event::QuitTest{});
+                } else {
+                    event_queue.push_event(Event::Return{});
+                }
+                return;
+            }
+
+            m_view = View::main;
+            begin_playback();
+        } else {
+            UI ui(memory.ui_allocator, &m_ui_hints, &m_ui_layout);
+            ui.begin_frame(constants::window_width, constants::window_height);
+            ui.text("Loading", {.position = Position::Anchor{0.5, 0.5}, .font_size = 40});
+            ui.end_frame(input);
+            ui.draw(renderer);
+            return;
+        }
+    }
+
     double elapsed{};
     if (!m_audio_started) {
         if (m_buffer_elapsed >= 0) {
@@ -191,7 +263,7 @@ void Game::update(std::chrono::duration<double> delta_time) {
         elapsed = audio.get_position();
     }
 
-    UI ui(memory.ui_allocator);
+    UI ui(memory.ui_allocator, &m_ui_hints, &m_ui_layout);
 
     ui.begin_frame(constants::window_width, constants::window_height);
 
@@ -205,57 +277,70 @@ void Game::update(std::chrono::duration<double> delta_time) {
     if (m_view == View::main) {
         if (input.key_down(SDL_SCANCODE_ESCAPE)) {
             audio.pause();
-            Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_back), 0);
+            audio.play_sound(assets.get_sound(SoundID::menu_back));
             m_view = View::paused;
         }
 
         double last_note_time = (m_map.times.size() == 0) ? 0 : m_map.times.back();
-        if (elapsed >= last_note_time + end_screen_delay.count() || elapsed >= Mix_MusicDuration(audio.m_music)) {
+        if (elapsed >= last_note_time + end_screen_delay.count() || elapsed >= audio.duration()) {
             if (m_test_mode) {
                 event_queue.push_event(Event::QuitTest{});               
             } else {
                 m_view = View::end_screen;
                 SDL_ShowCursor();
+                finish_play();
             }
         }
 
-        std::vector<DrumInput> inputs{};
+        // everything past here runs every frame of a play, keep it off the heap
+        mem::NoAllocScope no_alloc("Game::update");
+
+        // autoplay plus the four drum keys at most
+        std::array<DrumInput, 5> input_buffer;
+        int input_count = 0;
+        auto add_input = [&](DrumInput type) {
+            // only the last input_indicator_duration is ever drawn
+            if (input_history.size() == input_history.capacity()) {
+                auto first_recent = std::find_if(input_history.begin(), input_history.end(), [&](const InputRecord& record) {
+                    return elapsed - record.time <= input_indicator_duration;
+                });
+                input_history.erase(input_history.begin(), first_recent);
+            }
+            input_history.push_back(InputRecord{ type, elapsed });
+            input_buffer[input_count++] = type;
+        };
 
         if (m_auto_mode) {
             if (current_note_index < m_map.times.size()) {
                 if (elapsed >= m_map.times[current_note_index]) {
                     if (m_map.flags_list[current_note_index] & NoteFlagBits::don) {
-                        input_history.push_back(InputRecord{ DrumInput::don_left, elapsed });
-                        inputs.push_back(DrumInput::don_left);
+                        add_input(DrumInput::don_left);
                     }
                     else {
-                        input_history.push_back(InputRecord{ DrumInput::kat_left, elapsed });
-                        inputs.push_back(DrumInput::kat_left);
+                        add_input(DrumInput::kat_left);
                     }
                 }
             }
         }
 
         if (input.action_down(Input::ActionID::don_left)) {
-            input_history.push_back(InputRecord{ DrumInput::don_left, elapsed });
-            inputs.push_back(DrumInput::don_left);
+            add_input(DrumInput::don_left);
         }
 
         if (input.action_down(Input::ActionID::don_right)) {
-            input_history.push_back(InputRecord{ DrumInput::don_right, elapsed });
-            inputs.push_back(DrumInput::don_right);
+            add_input(DrumInput::don_right);
         }
 
         if (input.action_down(Input::ActionID::kat_left)) {
-            input_history.push_back(InputRecord{ DrumInput::kat_left, elapsed });
-            inputs.push_back(DrumInput::kat_left);
+            add_input(DrumInput::kat_left);
         }
 
         if (input.action_down(Input::ActionID::kat_right)) {
-            input_history.push_back(InputRecord{ DrumInput::kat_right, elapsed });
-            inputs.push_back(DrumInput::kat_right);
+            add_input(DrumInput::kat_right);
         }
 
+        auto inputs = std::span<const DrumInput>(input_buffer.data(), input_count);
+
         if (elapsed - hit_effect_time_point_seconds > hit_effect_duration.count()) {
             m_current_hit_effect = hit_effect::none;
         }
@@ -268,7 +353,7 @@ void Game::update(std::chrono::duration<double> delta_time) {
         // bool big_note_sound_played = false;
         if (current_note_index < m_map.times.size()) {
             for (const auto& input : inputs) {
-                auto error_duration = elapsed - m_map.times[current_note_index];
+                auto error_duration = elapsed - settings.global_offset - m_map.times[current_note_index];
                 if (std::abs(error_duration) <= ok_range.count() / 2) {
                     auto actual_type = (uint8_t)(m_map.flags_list[current_note_index] & NoteFlagBits::don);
                     auto input_type = (uint8_t)(input & DrumInputFlagBits::don_kat);
@@ -276,6 +361,7 @@ void Game::update(std::chrono::duration<double> delta_time) {
                         note_alive_list[current_note_index] = false;
                         hit_effect_time_point_seconds = elapsed;
                         combo++;
+                        m_hit_errors.push_back(error_duration);
                         if (error_duration <= perfect_range.count() / 2) {
                             m_current_hit_effect = hit_effect::perfect;
                             score += 300;
@@ -306,16 +392,16 @@ void Game::update(std::chrono::duration<double> delta_time) {
         // if(!big_note_sound_played) {
         for (const auto& input : inputs) {
             if (input == DrumInput::don_left || input == DrumInput::don_right) {
-                Mix_PlayChannel(-1, assets.get_sound(SoundID::don), 0);
+                audio.play_sound(assets.get_sound(SoundID::don));
             }
             else if (input == DrumInput::kat_left || input == DrumInput::kat_right) {
-                Mix_PlayChannel(-1, assets.get_sound(SoundID::kat), 0);
+                audio.play_sound(assets.get_sound(SoundID::kat));
             }
         }
 
         if (current_note_index < m_map.times.size()) {
             // if current note passed by completely without input attempts
-            if (elapsed - m_map.times[current_note_index] > ok_range.count() / 2) {
+            if (elapsed - settings.global_offset - m_map.times[current_note_index] > ok_range.count() / 2) {
                 combo = 0;
                 miss_count++;
 
@@ -485,13 +571,13 @@ void Game::update(std::chrono::duration<double> delta_time) {
         style.padding = even_padding(10);
 
         ui.begin_row(style);
-        ui.text(ui.strings.add(std::format("{}", score)), {.font_size=54 });
+        ui.text(ui.format("{}", score), {.font_size=54 });
 
-        ui.text(ui.strings.add(std::format("{:.2f}%", accuracy_fraction * 100)), {});
+        ui.text(ui.format("{:.2f}%", accuracy_fraction * 100), {});
         ui.end_row();
 
         ui.begin_row(Style{ Position::Anchor{0,1}, .padding=even_padding(10)});
-        ui.text(ui.strings.add(std::format("{}x", combo)), {.font_size=48});
+        ui.text(ui.format("{}x", combo), {.font_size=48});
         ui.end_row();
 
 
@@ -502,26 +588,26 @@ void Game::update(std::chrono::duration<double> delta_time) {
             "Quit",
         };
 
-        std::function<void()> lambdas[] = {
+        OnClick lambdas[] = {
             [&]() {
                 m_view = View::main;
                 SDL_HideCursor();
                 audio.resume();
-                Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_confirm), 0);
+                audio.play_sound(assets.get_sound(SoundID::menu_confirm));
             },
             [&]() {
                 event_queue.push_event(Event::GameReset{});
-                Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_confirm), 0);
+                audio.play_sound(assets.get_sound(SoundID::menu_confirm));
             },
             [&]() {
                 event_queue.push_event(Event::Return{});
-                Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_confirm), 0);
+                audio.play_sound(assets.get_sound(SoundID::menu_confirm));
             }
         };
 
         if (input.key_down(SDL_SCANCODE_ESCAPE)) {
             lambdas[0]();
-            Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_back), 0);
+            audio.play_sound(assets.get_sound(SoundID::menu_back));
         }
 
         if (input.key_down(SDL_SCANCODE_RETURN)) {
@@ -530,12 +616,12 @@ void Game::update(std::chrono::duration<double> delta_time) {
 
         if (input.key_down(SDL_SCANCODE_LEFT) && m_paused_selected_option > 0) {
             m_paused_selected_option--;
-            Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_select), 0);
+            audio.play_sound(assets.get_sound(SoundID::menu_select));
         }
 
         if (input.key_down(SDL_SCANCODE_RIGHT) && m_paused_selected_option < 2) {
             m_paused_selected_option++;
-            Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_select), 0);
+            audio.play_sound(assets.get_sound(SoundID::menu_select));
         }
 
         Style st{};
@@ -560,7 +646,7 @@ void Game::update(std::chrono::duration<double> delta_time) {
                     anim_st.alt_background_color = color::bg_highlight;
                     ui.button_anim(texts[i], &m_pause_menu_buttons[i], st, anim_st, [&, i]() {
                         m_paused_selected_option = i;
-                        Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_select), 0);
+                        audio.play_sound(assets.get_sound(SoundID::menu_select));
                     });
                 }
 
@@ -572,7 +658,7 @@ void Game::update(std::chrono::duration<double> delta_time) {
             SDL_ShowCursor();
             if (m_test_mode) {
                 event_queue.push_event(Event::QuitTest{});
-                Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_back), 0);
+                audio.play_sound(assets.get_sound(SoundID::menu_back));
             }
             else {
                 event_queue.push_event(Event::Return{});
@@ -591,6 +677,24 @@ void Game::update(std::chrono::duration<double> delta_time) {
         ui.text(ui.strings.add(std::format("{} Ok", ok_count)), {});
         ui.text(ui.strings.add(std::format("{} Miss", miss_count)), {});
 
+        if (m_hit_stats.count > 0) {
+            ui.text(ui.strings.add(std::format("{:+.1f} ms mean  {:.1f} ms stddev  {:.1f} UR", m_hit_stats.mean * 1000, m_hit_stats.stddev * 1000, m_hit_stats.unstable_rate)), {});
+
+            // early on the left, late on the right
+            const float max_bar_height = 160;
+            const double bin_width = hit_histogram_range * 2 / hit_histogram_bins;
+            ui.begin_row({.height=Scale::Fixed{max_bar_height}, .align_items=Alignment::End, .gap=3});
+            for (int i = 0; i < hit_histogram_bins; i++) {
+                double bin_center = -hit_histogram_range + (i + 0.5) * bin_width;
+                RGBA bar_color = std::abs(bin_center) <= perfect_range.count() / 2 ? RGBA{255, 200, 60, 255} : RGBA{120, 220, 120, 255};
+
+                float height = std::max(2.0f, max_bar_height * m_hit_stats.histogram[i] / m_hit_stats.histogram_peak);
+                ui.begin_row({.background_color=bar_color, .width=Scale::Fixed{12}, .height=Scale::Fixed{height}});
+                ui.end_row();
+            }
+            ui.end_row();
+        }
+
         ui.button("Back", {.position=Position::Anchor{0, 1}, .font_size=40}, [&]() {
             event_queue.push_event(Event::Return{});
             });
@@ -10,6 +10,7 @@
 #include "constants.h"
 
 #include "assets.h"
+#include "timing_stats.h"
 
 class Cam {
 public:
@@ -61,6 +62,7 @@ struct InitConfig {
 };
 
 enum class View {
+    loading,
     main,
     paused,
     end_screen,
@@ -75,6 +77,7 @@ class Game {
 public:
     Game(Systems systems, game::InitConfig config);
     void start();
+    void begin_playback();
     void update(std::chrono::duration<double> delta_time);
 
     InitConfig config{};
@@ -85,6 +88,7 @@ private:
     Audio& audio;
     AssetLoader& assets;
     EventQueue& event_queue;
+    Settings& settings;
 
     Cam cam{{0,0}, {1.5f, 1.5f}};
 
@@ -114,7 +118,7 @@ private:
 
     std::vector<double> m_miss_effects;
 
-    View m_view{};
+    View m_view{View::main};
     int m_paused_selected_option{};
     AnimState m_pause_menu_buttons[3]{};
 
@@ -125,6 +129,15 @@ private:
     double m_buffer_elapsed{};
     bool m_audio_started = false;
 
+    MusicLoad m_music_load;
+    UICapacityHints m_ui_hints{};
+    UILayoutCache m_ui_layout{};
+
+    // signed error of every judged hit with the global offset applied, reserved up front
+    std::vector<double> m_hit_errors;
+    HitErrorStats m_hit_stats{};
+    void finish_play();
+
     void draw_map();
 };
 }
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature, size_t Capacity = 48>
+class InlineFunction;
+
+// type erased callable that keeps its captures inside itself instead of on the heap, so a
+// temp::vector of these puts the closures straight into the frame arena.
+// captures have to fit and be trivially copyable (references, pointers, plain values),
+// the arena never runs destructors
+template <typename R, typename... Args, size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+  public:
+    InlineFunction() = default;
+    InlineFunction(std::nullptr_t) {}
+
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineFunction>>>
+    InlineFunction(F&& f) {
+        using Fn = std::decay_t<F>;
+        static_assert(sizeof(Fn) <= Capacity, "closure captures too much, capture a pointer to the state instead");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t));
+        static_assert(std::is_trivially_copyable_v<Fn> && std::is_trivially_destructible_v<Fn>, "closure captures have to be trivially copyable");
+
+        new (m_storage) Fn(std::forward<F>(f));
+        m_call = [](void* storage, Args... args) -> R {
+            return (*(Fn*)storage)(std::forward<Args>(args)...);
+        };
+    }
+
+    R operator()(Args... args) const {
+        return m_call((void*)m_storage, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const {
+        return m_call != nullptr;
+    }
+
+  private:
+    alignas(std::max_align_t) unsigned char m_storage[Capacity];
+    R (*m_call)(void*, Args...) = nullptr;
+};
@@ -9,6 +9,7 @@ void Input::begin_frame() {
     ZoneScoped;
 
     std::fill(keyboard_repeat.begin(), keyboard_repeat.end(), false);
+    action_down_times.fill(0);
     current_mouse = SDL_GetMouseState(&mouse_pos.x, &mouse_pos.y);
     mod_state = SDL_GetModState();
 }
@@ -33,6 +34,18 @@ bool Input::action_down(int action_id) {
     return this->key_down(keybindings[action_id]);
 }
 
+uint64_t Input::action_down_ns(int action_id) const {
+    return action_down_times[action_id];
+}
+
+void Input::record_key_down(SDL_Scancode scancode, uint64_t timestamp_ns) {
+    for (int action = 0; action < ActionID::count; action++) {
+        if (keybindings[action] == scancode && action_down_times[action] == 0) {
+            action_down_times[action] = timestamp_ns;
+        }
+    }
+}
+
 bool Input::modifier(const SDL_Keymod modifiers) const {
     return (modifiers & mod_state);
 }
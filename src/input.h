@@ -41,6 +41,10 @@ class Input {
 
     void init_keybinds(std::array<Keybind, ActionID::count> keybinds);
     bool action_down(int action_id);
+    // SDL_GetTicksNS time of the key down event behind action_down, 0 if there wasnt one this frame
+    uint64_t action_down_ns(int action_id) const;
+    // call for every non repeat SDL_EVENT_KEY_DOWN, keeps the first press of each action per frame
+    void record_key_down(SDL_Scancode scancode, uint64_t timestamp_ns);
 
     bool key_down(const SDL_Scancode& scan_code) const;
     bool key_held(const SDL_Scancode& scan_code) const;
@@ -63,6 +67,7 @@ class Input {
     std::optional<SDL_Scancode> m_key_this_frame;
 
   private:
+    std::array<uint64_t, ActionID::count> action_down_times{};
     std::array<bool, SDL_SCANCODE_COUNT> last_keyboard{};
     const bool* current_keyboard = SDL_GetKeyboardState(NULL);
 
@@ -0,0 +1,120 @@
+#include "jobs.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <tracy/Tracy.hpp>
+#include <vector>
+
+namespace jobs {
+
+std::mutex queue_mutex;
+std::condition_variable queue_cv;
+std::queue<std::function<void()>> queue;
+std::queue<std::function<void()>> background_queue;
+std::vector<std::thread> workers;
+bool stopping = false;
+
+int background_running = 0;
+int background_limit = 1;
+
+bool can_start_background() {
+    return !background_queue.empty() && background_running < background_limit;
+}
+
+void worker_loop() {
+    while (1) {
+        std::function<void()> job;
+        bool background = false;
+        {
+            std::unique_lock lock(queue_mutex);
+            queue_cv.wait(lock, []() { return stopping || !queue.empty() || can_start_background(); });
+
+            if (stopping && queue.empty()) {
+                return;
+            }
+
+            if (!queue.empty()) {
+                job = std::move(queue.front());
+                queue.pop();
+            } else {
+                job = std::move(background_queue.front());
+                background_queue.pop();
+                background = true;
+                background_running++;
+            }
+        }
+
+        ZoneNamedN(var, "job", true);
+        job();
+
+        if (background) {
+            {
+                std::lock_guard lock(queue_mutex);
+                background_running--;
+            }
+            // a worker might be parked on the background limit
+            queue_cv.notify_one();
+        }
+    }
+}
+
+void init(int thread_count) {
+    stopping = false;
+    thread_count = std::max(thread_count, 1);
+    // keep a worker free for normal jobs when there is more than one
+    background_limit = std::max(thread_count - 1, 1);
+
+    for (int i = 0; i < thread_count; i++) {
+        workers.emplace_back(worker_loop);
+    }
+}
+
+void shutdown() {
+    {
+        std::lock_guard lock(queue_mutex);
+        stopping = true;
+
+        // whatever hasnt started yet gets dropped, their futures see a broken promise
+        queue = {};
+        background_queue = {};
+    }
+    queue_cv.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void push(std::function<void()>&& job, Priority priority) {
+    {
+        std::lock_guard lock(queue_mutex);
+        if (priority == Priority::background) {
+            background_queue.push(std::move(job));
+        } else {
+            queue.push(std::move(job));
+        }
+    }
+    queue_cv.notify_one();
+}
+
+bool try_run_one() {
+    std::function<void()> job;
+    {
+        std::lock_guard lock(queue_mutex);
+        if (queue.empty()) {
+            return false;
+        }
+
+        job = std::move(queue.front());
+        queue.pop();
+    }
+
+    job();
+    return true;
+}
+
+} // namespace jobs
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+// small fixed worker pool for anything that shouldnt run on the render thread
+// (decoding, analysis, file io)
+namespace jobs {
+
+void init(int thread_count);
+void shutdown();
+
+enum class Priority {
+    normal,
+    // only starts when nothing normal is queued and never takes every worker,
+    // for batch work (library analysis) that shouldnt hold up loads and decodes
+    background,
+};
+
+void push(std::function<void()>&& job, Priority priority = Priority::normal);
+
+// runs one normal queued job on the calling thread, false if there was nothing queued
+bool try_run_one();
+
+template <typename F>
+auto submit(F&& job, Priority priority = Priority::normal) -> std::future<std::invoke_result_t<F>> {
+    using Result = std::invoke_result_t<F>;
+
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+    auto future = task->get_future();
+    push([task]() { (*task)(); }, priority);
+
+    return future;
+}
+
+template <typename T>
+bool ready(const std::future<T>& future) {
+    return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+// for jobs that fan out, works through the queue instead of parking a worker
+template <typename T>
+T wait(std::future<T>& future) {
+    while (!ready(future)) {
+        if (!try_run_one()) {
+            std::this_thread::yield();
+        }
+    }
+
+    return future.get();
+}
+
+} // namespace jobs
@@ -0,0 +1,214 @@
+#include <cmath>
+#include <format>
+#include <numbers>
+#include <tracy/Tracy.hpp>
+
+#include "loudness.h"
+#include "constants.h"
+#include "dev_macros.h"
+#include "serialize.h"
+#include "simd.h"
+
+struct Biquad {
+    double b0, b1, b2, a1, a2;
+};
+
+// the two k weighting stages for any sample rate, same derivation as libebur128
+Biquad shelf_filter(double frequency) {
+    const double f0 = 1681.974450955533;
+    const double gain_db = 3.999843853973347;
+    const double q = 0.7071752369554196;
+
+    double k = std::tan(std::numbers::pi * f0 / frequency);
+    double vh = std::pow(10.0, gain_db / 20);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1 + k / q + k * k;
+
+    return {
+        (vh + vb * k / q + k * k) / a0,
+        2 * (k * k - vh) / a0,
+        (vh - vb * k / q + k * k) / a0,
+        2 * (k * k - 1) / a0,
+        (1 - k / q + k * k) / a0,
+    };
+}
+
+Biquad highpass_filter(double frequency) {
+    const double f0 = 38.13547087602444;
+    const double q = 0.5003270373238773;
+
+    double k = std::tan(std::numbers::pi * f0 / frequency);
+    double a0 = 1 + k / q + k * k;
+
+    return {1, -2, 1, 2 * (k * k - 1) / a0, (1 - k / q + k * k) / a0};
+}
+
+constexpr int max_lanes = 4;
+
+// filters every channel at once, one channel per lane, and sums the squared output
+// into 100 ms sub blocks (one float per channel each)
+std::vector<float> weighted_power(const PcmTrack& track, int64_t sub_block_frames) {
+    ZoneScoped;
+
+    const int lanes = std::min(track.channels, max_lanes);
+    const Biquad shelf = shelf_filter(track.frequency);
+    const Biquad highpass = highpass_filter(track.frequency);
+
+    const int64_t sub_block_count = track.frames() / sub_block_frames;
+    std::vector<float> power(sub_block_count * max_lanes);
+
+    alignas(16) float in[max_lanes]{};
+    alignas(16) float lanes_out[max_lanes];
+
+#ifdef SIMD_SSE
+    // transposed direct form 2, z1/z2 per stage
+    const __m128 s_b0 = _mm_set1_ps(shelf.b0), s_b1 = _mm_set1_ps(shelf.b1), s_b2 = _mm_set1_ps(shelf.b2);
+    const __m128 s_a1 = _mm_set1_ps(shelf.a1), s_a2 = _mm_set1_ps(shelf.a2);
+    const __m128 h_b0 = _mm_set1_ps(highpass.b0), h_b1 = _mm_set1_ps(highpass.b1), h_b2 = _mm_set1_ps(highpass.b2);
+    const __m128 h_a1 = _mm_set1_ps(highpass.a1), h_a2 = _mm_set1_ps(highpass.a2);
+    __m128 s_z1 = _mm_setzero_ps(), s_z2 = _mm_setzero_ps();
+    __m128 h_z1 = _mm_setzero_ps(), h_z2 = _mm_setzero_ps();
+
+    for (int64_t block = 0; block < sub_block_count; block++) {
+        __m128 sum = _mm_setzero_ps();
+        const float* src = track.samples.data() + block * sub_block_frames * track.channels;
+
+        for (int64_t i = 0; i < sub_block_frames; i++, src += track.channels) {
+            for (int c = 0; c < lanes; c++) {
+                in[c] = src[c];
+            }
+            __m128 x = _mm_load_ps(in);
+
+            __m128 y = _mm_add_ps(_mm_mul_ps(s_b0, x), s_z1);
+            s_z1 = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(s_b1, x), s_z2), _mm_mul_ps(s_a1, y));
+            s_z2 = _mm_sub_ps(_mm_mul_ps(s_b2, x), _mm_mul_ps(s_a2, y));
+
+            __m128 z = _mm_add_ps(_mm_mul_ps(h_b0, y), h_z1);
+            h_z1 = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(h_b1, y), h_z2), _mm_mul_ps(h_a1, z));
+            h_z2 = _mm_sub_ps(_mm_mul_ps(h_b2, y), _mm_mul_ps(h_a2, z));
+
+            sum = _mm_add_ps(sum, _mm_mul_ps(z, z));
+        }
+
+        _mm_store_ps(lanes_out, sum);
+        std::copy(lanes_out, lanes_out + max_lanes, power.begin() + block * max_lanes);
+    }
+#else
+    float s_z1[max_lanes]{}, s_z2[max_lanes]{}, h_z1[max_lanes]{}, h_z2[max_lanes]{};
+
+    for (int64_t block = 0; block < sub_block_count; block++) {
+        float sum[max_lanes]{};
+        const float* src = track.samples.data() + block * sub_block_frames * track.channels;
+
+        for (int64_t i = 0; i < sub_block_frames; i++, src += track.channels) {
+            for (int c = 0; c < lanes; c++) {
+                float x = src[c];
+
+                float y = shelf.b0 * x + s_z1[c];
+                s_z1[c] = shelf.b1 * x + s_z2[c] - shelf.a1 * y;
+                s_z2[c] = shelf.b2 * x - shelf.a2 * y;
+
+                float z = highpass.b0 * y + h_z1[c];
+                h_z1[c] = highpass.b1 * y + h_z2[c] - highpass.a1 * z;
+                h_z2[c] = highpass.b2 * y - highpass.a2 * z;
+
+                sum[c] += z * z;
+            }
+        }
+
+        std::copy(sum, sum + max_lanes, power.begin() + block * max_lanes);
+    }
+    (void)in;
+    (void)lanes_out;
+#endif
+
+    return power;
+}
+
+double block_loudness(double mean_square) {
+    return -0.691 + 10 * std::log10(mean_square);
+}
+
+std::optional<double> integrated_loudness(const PcmTrack& track) {
+    ZoneScoped;
+
+    // 400 ms gating blocks with 75% overlap, built out of 100 ms pieces
+    const int64_t sub_block_frames = track.frequency / 10;
+    const auto power = weighted_power(track, sub_block_frames);
+    const int64_t sub_block_count = power.size() / max_lanes;
+
+    std::vector<double> blocks;
+    for (int64_t i = 0; i + 4 <= sub_block_count; i++) {
+        double sum = 0;
+        for (int64_t j = i * max_lanes; j < (i + 4) * max_lanes; j++) {
+            sum += power[j];
+        }
+        blocks.push_back(sum / (sub_block_frames * 4));
+    }
+
+    auto gated_mean = [&](double threshold) {
+        double sum = 0;
+        int count = 0;
+        for (double block : blocks) {
+            if (block_loudness(block) > threshold) {
+                sum += block;
+                count++;
+            }
+        }
+        return count > 0 ? std::optional<double>(sum / count) : std::nullopt;
+    };
+
+    auto absolute = gated_mean(-70);
+    if (!absolute.has_value()) {
+        return std::nullopt;
+    }
+
+    auto relative = gated_mean(block_loudness(absolute.value()) - 10);
+    double loudness = block_loudness(relative.value_or(absolute.value()));
+
+    DEV_LOG(std::format("loudness: {:.1f} LUFS over {:.1f} s\n", loudness, track.duration()));
+
+    return loudness;
+}
+
+float loudness_gain(const MapSetInfo& mapset) {
+    if (!mapset.loudness_analyzed) {
+        return 1;
+    }
+
+    double gain_db = std::min(0.0, target_loudness - mapset.loudness);
+    return (float)std::pow(10.0, gain_db / 20);
+}
+
+std::optional<double> analyze_mapset_loudness(const std::filesystem::path& mapset_directory) {
+    ZoneScoped;
+
+    auto music_file = find_music_file(mapset_directory);
+    if (!music_file.has_value()) {
+        return std::nullopt;
+    }
+
+    auto track = decode_pcm(music_file.value().string().data());
+    if (track == nullptr) {
+        return std::nullopt;
+    }
+
+    // silent tracks count as analyzed so they dont get decoded again every launch
+    return integrated_loudness(*track).value_or(target_loudness);
+}
+
+bool store_mapset_loudness(const std::filesystem::path& mapset_directory, double loudness) {
+    auto mapset_file = mapset_directory / constants::mapset_filename;
+
+    try {
+        MapSetInfo info{};
+        load_binary(info, mapset_file);
+        info.loudness_analyzed = true;
+        info.loudness = loudness;
+        save_binary(info, mapset_file);
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    return true;
+}
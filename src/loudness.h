@@ -0,0 +1,24 @@
+#pragma once
+
+#include <filesystem>
+
+#include "map.h"
+#include "pcm.h"
+
+// everything gets pulled down toward this, quieter songs are left alone
+constexpr double target_loudness = -14;
+
+// integrated loudness in LUFS (bs.1770 k weighting with the ebu r128 gates)
+// nullopt for silence
+std::optional<double> integrated_loudness(const PcmTrack& track);
+
+// linear music gain for a mapset, 1 if it hasnt been analyzed
+float loudness_gain(const MapSetInfo& mapset);
+
+// blocking, decodes the mapsets music and measures it, doesnt touch the mapset file
+// nullopt if there was no music to decode
+std::optional<double> analyze_mapset_loudness(const std::filesystem::path& mapset_directory);
+
+// writes a measurement into the mapset file, main thread only so it cant race the editor or
+// a reload reading the same file. false if the file couldnt be read or written
+bool store_mapset_loudness(const std::filesystem::path& mapset_directory, double loudness);
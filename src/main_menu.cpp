@@ -8,7 +8,11 @@
 #include "assets.h"
 #include "audio.h"
 #include "constants.h"
+#include "damage.h"
+#include "dev_macros.h"
 #include "input.h"
+#include "jobs.h"
+#include "loudness.h"
 #include "map.h"
 #include "serialize.h"
 #include "ui.h"
@@ -25,22 +29,131 @@ MainMenu::MainMenu(
     Input::Input& _input,
     Audio& _audio,
     AssetLoader& _assets,
-    EventQueue& _event_queue
+    EventQueue& _event_queue,
+    Settings& _settings
 )
-    : memory(memory), renderer{_renderer}, input{_input}, audio{_audio}, assets{_assets}, event_queue{_event_queue} {
+    : memory(memory), renderer{_renderer}, input{_input}, audio{_audio}, assets{_assets}, event_queue{_event_queue}, settings{_settings} {
 }
 
 void MainMenu::play_selected_music() {
-    if (m_mapset_paths.size() > 0) {
-        auto mapset_directory = m_mapset_paths[m_selected_mapset_index];
-        auto music_file = find_music_file(mapset_directory);
-        if (music_file.has_value()) {
-            audio.load_music(music_file.value().string().data());
-            audio.fade_in(std::numeric_limits<int>::max(), 300);
-            audio.set_position(m_mapsets[m_selected_mapset_index].preview_time);
-            audio.resume();
+    if (m_mapset_paths.size() == 0) {
+        return;
+    }
+
+    m_pending_preview = m_selected_mapset_index;
+    m_stream_load.reset();
+
+    // likely the next ones to be picked
+    for (int neighbour : {m_selected_mapset_index - 1, m_selected_mapset_index + 1}) {
+        if (neighbour >= 0 && neighbour < m_mapset_paths.size()) {
+            m_previews.prefetch(m_mapset_paths[neighbour], m_mapsets[neighbour].preview_time);
+        }
+    }
+
+    update_preview();
+}
+
+void MainMenu::update_preview() {
+    if (music_loaded(m_stream_load)) {
+        bool was_paused = audio.paused();
+
+        if (audio.use_music(m_stream_load) == 0) {
+            m_preview_clip = nullptr;
+            audio.play(std::numeric_limits<int>::max());
+            audio.set_position(m_stream_position);
+            if (was_paused) {
+                audio.pause();
+            }
+        }
+        m_stream_load.reset();
+    }
+
+    if (!m_pending_preview.has_value()) {
+        return;
+    }
+
+    int index = m_pending_preview.value();
+    auto clip = m_previews.get(m_mapset_paths[index], m_mapsets[index].preview_time);
+    if (clip == nullptr) {
+        return;
+    }
+
+    m_pending_preview.reset();
+    m_preview_clip = clip;
+    audio.set_music_gain(loudness_gain(m_mapsets[index]));
+    audio.play_pcm(clip->pcm, std::numeric_limits<int>::max(), 300);
+}
+
+// call with map_reloading_mutex held
+void MainMenu::update_loudness_jobs() {
+    for (auto& job : m_loudness_jobs) {
+        if (!jobs::ready(job.result)) {
+            continue;
         }
+
+        auto loudness = job.result.get();
+        if (!loudness.has_value()) {
+            continue;
+        }
+
+        for (int i = 0; i < m_mapset_paths.size(); i++) {
+            if (m_mapset_paths[i] != job.mapset_directory) {
+                continue;
+            }
+
+            m_mapsets[i].loudness_analyzed = true;
+            m_mapsets[i].loudness = loudness.value();
+
+            // still applies for this session if it didnt save, it just gets measured again next launch
+            if (!store_mapset_loudness(job.mapset_directory, loudness.value())) {
+                DEV_LOG(std::format("loudness: couldnt write {}\n", job.mapset_directory.string()));
+            }
+
+            if (i == m_selected_mapset_index) {
+                audio.set_music_gain(loudness_gain(m_mapsets[i]));
+            }
+        }
+    }
+
+    std::erase_if(m_loudness_jobs, [](const LoudnessJob& job) {
+        return !job.result.valid();
+    });
+}
+
+double MainMenu::music_position() {
+    if (m_preview_clip != nullptr) {
+        return m_preview_clip->start + audio.get_position();
+    }
+
+    return audio.get_position();
+}
+
+double MainMenu::music_duration() {
+    if (m_preview_clip != nullptr) {
+        return m_preview_clip->song_duration;
     }
+
+    return audio.duration();
+}
+
+void MainMenu::seek_music(double position) {
+    if (m_preview_clip == nullptr) {
+        audio.set_position(position);
+        return;
+    }
+
+    double clip_position = position - m_preview_clip->start;
+    if (clip_position >= 0 && clip_position < audio.duration()) {
+        m_stream_load.reset();
+        audio.set_position(clip_position);
+        return;
+    }
+
+    // outside the clip, open the whole song and switch over once its ready
+    if (m_stream_load == nullptr) {
+        m_stream_load = load_music_async(m_preview_clip->music_file);
+    }
+    m_stream_position = position;
 }
 
 void MainMenu::reload_maps() {
@@ -59,6 +172,17 @@ void MainMenu::reload_maps() {
 
         load_binary(m_mapsets.back(), mapset.path() / mapset_filename);
 
+        bool analyzing = std::any_of(m_loudness_jobs.begin(), m_loudness_jobs.end(), [&](const LoudnessJob& job) {
+            return job.mapset_directory == mapset.path();
+        });
+        if (!m_mapsets.back().loudness_analyzed && !analyzing) {
+            // a full decode each, background so a big library doesnt hold up previews and loads
+            m_loudness_jobs.push_back({mapset.path(), jobs::submit([directory = mapset.path()]() {
+                mem::TagScope tag(MemTag::audio);
+                return analyze_mapset_loudness(directory);
+            }, jobs::Priority::background)});
+        }
+
         for (const auto& entry : std::filesystem::directory_iterator(mapset.path())) {
             if (entry.path().extension().string().compare(map_file_extension) == 0) {
                 m_mapmetas.push_back({});
@@ -74,6 +198,10 @@ void MainMenu::reload_maps() {
 
     m_mapset_buttons = std::vector<AnimState>(m_mapsets.size());
 
+    // indices into the old vectors, a mapset might have been deleted
+    m_pending_preview.reset();
+    m_selected_mapset_index = std::clamp(m_selected_mapset_index, 0, std::max(0, (int)m_mapsets.size() - 1));
+
     this->play_selected_music();
 }
 
@@ -89,6 +217,12 @@ void MainMenu::awake() {
 void MainMenu::update(double delta_time) {
     ZoneScoped;
 
+    update_preview();
+    {
+        std::lock_guard lock(map_reloading_mutex);
+        update_loudness_jobs();
+    }
+
     if (input.key_down(SDL_SCANCODE_F5)) {
         reload_maps();
     }
@@ -111,7 +245,7 @@ void MainMenu::update(double delta_time) {
     //     std::cerr << "akjhfkalsdhf\n";
     // }
 
-    UI ui(memory.ui_allocator);
+    UI ui(memory.ui_allocator, &m_ui_hints, &m_ui_layout);
 
     ui.begin_frame(constants::window_width, constants::window_height);
 
@@ -127,7 +261,9 @@ void MainMenu::update(double delta_time) {
 
         Style active_style{};
 
-        std::vector<ButtonInfo> option;
+        ScratchScope scratch;
+        temp::vector<ButtonInfo> option(scratch.arena);
+        option.reserve(3);
         option.push_back({"Play", [&]() {
             m_view = View::Main;
             m_entry_mode = EntryMode::Play; 
@@ -177,8 +313,6 @@ void MainMenu::update(double delta_time) {
         ui.end_row();
     };
 
-    SDL_RenderTexture(renderer, assets.get_image(ImageID::bg).texture, NULL, NULL);
-
 
     if (m_choosing_mapset_index.has_value()) {
         auto mapset_index = m_choosing_mapset_index.value();
@@ -186,19 +320,19 @@ void MainMenu::update(double delta_time) {
 
         if (input.key_down(SDL_SCANCODE_LEFT) && m_selected_diff_index > 0) {
             m_selected_diff_index--;
-            Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_select), 0);
+            audio.play_sound(assets.get_sound(SoundID::menu_select));
         }
         if (input.key_down(SDL_SCANCODE_RIGHT) && m_selected_diff_index < map_buffer.count - 1) {
             m_selected_diff_index++;
-            Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_select), 0);
+            audio.play_sound(assets.get_sound(SoundID::menu_select));
         }
         if (input.key_down(SDL_SCANCODE_ESCAPE)) {
             m_choosing_mapset_index = {};
-            Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_back), 0);
+            audio.play_sound(assets.get_sound(SoundID::menu_back));
         }
         if (input.key_down(SDL_SCANCODE_RETURN)) {
             auto& map = m_mapmetas[map_buffer.index + m_selected_diff_index];
-            Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_confirm), 0);
+            audio.play_sound(assets.get_sound(SoundID::menu_confirm));
             event_queue.push_event(
                 Event::PlayMap{m_mapset_paths[mapset_index], (map.difficulty_name + map_file_extension)}
             );
@@ -268,7 +402,7 @@ Anything else = hardest diff)"
                     anim_style,
                     [&, i]() {
                         m_selected_diff_index = i;
-                        Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_select), 0);
+                        audio.play_sound(assets.get_sound(SoundID::menu_select));
                     }
                 );
             }
@@ -349,7 +483,7 @@ Escape)",
                 m_choosing_mapset_index = m_selected_mapset_index;
                 m_selected_diff_index = 0;
                 m_diff_buttons = std::vector<AnimState>(m_map_buffers[m_selected_mapset_index].count);
-                Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_confirm), 0);
+                audio.play_sound(assets.get_sound(SoundID::menu_confirm));
             }
             // event_queue.push_event(Event::PlayMap{
             //     mapset_directory, (map_info.difficulty_name + map_file_extension)
@@ -411,12 +545,12 @@ Escape)",
 
         if (input.key_down(SDL_SCANCODE_LEFT) && m_selected_mapset_index > 0) {
             m_selected_mapset_index--;
-            Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_select), 0);
+            audio.play_sound(assets.get_sound(SoundID::menu_select));
             this->play_selected_music();
         }
         if (input.key_down(SDL_SCANCODE_RIGHT) && m_selected_mapset_index < m_mapsets.size() - 1) {
             m_selected_mapset_index++;
-            Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_select), 0);
+            audio.play_sound(assets.get_sound(SoundID::menu_select));
             this->play_selected_music();
         }
 
@@ -438,63 +572,63 @@ Escape)",
         auto start_pos = Vec2{(constants::window_width - map_item_width) / 2.0f, (constants::window_height - map_item_height) / 2.0f};
         float gap{20};
 
-        map_reloading_mutex.lock();
-        for (int i = 0; i < m_mapsets.size(); i++) {
-            auto item_st = Style{};
-            item_st.stack_direction = StackDirection::Vertical;
-            item_st.width = Scale::Fixed{map_item_width};
-            item_st.height = Scale::Fixed{map_item_height};
-            item_st.padding = even_padding(25);
-            item_st.background_color = color::bg;
-
-
-            auto index_offset = m_scroll_pos - i;
-            auto offset = index_offset * Vec2{0, map_item_height + gap};
-
-            item_st.position = Position::Absolute{start_pos - offset};
-
-            auto& mapset = m_mapsets[i];
-            auto& mapset_directory = m_mapset_paths[i];
-
-            Style idk{};
-            idk.text_color = Inherit{};
-            idk.width = Scale::FitParent{};
+        VirtualListStyle list_st{};
+        list_st.origin = start_pos;
+        list_st.item_extent = map_item_height + gap;
+        list_st.viewport_length = constants::window_height;
 
-            auto idk2 = idk;
-            idk2.font_size=28;
-
-            if (i == m_selected_mapset_index) {
-                item_st.background_color = color::white;
-                item_st.text_color = RGBA{31, 31, 31, 200};
-
-                ui.begin_row_button(item_st, [&, i]() {
-                    if (m_entry_mode == EntryMode::Play) {
-                        m_choosing_mapset_index = m_selected_mapset_index;
-                        m_diff_buttons = std::vector<AnimState>(m_map_buffers[m_selected_mapset_index].count);
-                        m_selected_diff_index = {};
-                    } else {
-                        event_queue.push_event(Event::EditMap{m_mapset_paths[m_selected_mapset_index], {}});
-                    }
-                });
-                ui.text(mapset.title.data(), idk);
-                ui.text(mapset.artist.data(), idk2);
-                ui.end_row();
-            } else {
-                AnimStyle anim_st = {};
-                anim_st.alt_background_color = color::bg_highlight;
-
-                ui.begin_row_button_anim(&m_mapset_buttons[i], item_st, anim_st, [&, i]() {
-                    m_selected_mapset_index = i; 
-                    Mix_PlayChannel(-1, assets.get_sound(SoundID::menu_select), 0);
-                    this->play_selected_music();
-                });
-                ui.text(mapset.title.data(), idk);
-                ui.text(mapset.artist.data(), idk2);
-                ui.end_row();
+        // only the ~10 items on screen get built, the lock only has to cover those
+        {
+            std::lock_guard lock(map_reloading_mutex);
+            ui.virtual_list(m_mapsets.size(), m_scroll_pos, list_st, [&](int i, Vec2 position) {
+                auto item_st = Style{};
+                item_st.stack_direction = StackDirection::Vertical;
+                item_st.width = Scale::Fixed{map_item_width};
+                item_st.height = Scale::Fixed{map_item_height};
+                item_st.padding = even_padding(25);
+                item_st.background_color = color::bg;
+                item_st.position = Position::Absolute{position};
+
+                auto& mapset = m_mapsets[i];
+
+                Style idk{};
+                idk.text_color = Inherit{};
+                idk.width = Scale::FitParent{};
+
+                auto idk2 = idk;
+                idk2.font_size=28;
+
+                if (i == m_selected_mapset_index) {
+                    item_st.background_color = color::white;
+                    item_st.text_color = RGBA{31, 31, 31, 200};
+
+                    ui.begin_row_button(item_st, [this]() {
+                        if (m_entry_mode == EntryMode::Play) {
+                            m_choosing_mapset_index = m_selected_mapset_index;
+                            m_diff_buttons = std::vector<AnimState>(m_map_buffers[m_selected_mapset_index].count);
+                            m_selected_diff_index = {};
+                        } else {
+                            event_queue.push_event(Event::EditMap{m_mapset_paths[m_selected_mapset_index], {}});
+                        }
+                    });
+                    ui.text(mapset.title.data(), idk);
+                    ui.text(mapset.artist.data(), idk2);
+                    ui.end_row();
+                } else {
+                    AnimStyle anim_st = {};
+                    anim_st.alt_background_color = color::bg_highlight;
 
-            }
+                    ui.begin_row_button_anim(&m_mapset_buttons[i], item_st, anim_st, [this, i]() {
+                        m_selected_mapset_index = i; 
+                        audio.play_sound(assets.get_sound(SoundID::menu_select));
+                        this->play_selected_music();
+                    });
+                    ui.text(mapset.title.data(), idk);
+                    ui.text(mapset.artist.data(), idk2);
+                    ui.end_row();
+                }
+            });
         }
-        map_reloading_mutex.unlock();
 
 
         begin_banner();
@@ -533,7 +667,7 @@ Escape)",
         }
 
 
-        auto duration = Mix_MusicDuration(audio.m_music);
+        auto duration = music_duration();
 
         slider_st = {};
         slider_st.width = 300;
@@ -544,9 +678,9 @@ Escape)",
         ui.slider(
             m_music_playback_slider,
             slider_st,
-            audio.get_position() / duration,
+            duration > 0 ? music_position() / duration : 0,
             SliderCallbacks{
-                [&, duration](float fraction) { audio.set_position(fraction * duration); },
+                [&, duration](float fraction) { seek_music(fraction * duration); },
                 [&]() { audio.pause(); },
                 [&]() { audio.resume(); }
             }
@@ -564,8 +698,8 @@ Escape)",
                 return time{mins,secs};
             };
 
-            auto current = split_time(audio.get_position());
-            auto total = split_time(Mix_MusicDuration(audio.m_music));
+            auto current = split_time(music_position());
+            auto total = split_time(duration);
 
             auto text = ui.strings.add(std::format("{:02}:{:02}/{:02}:{:02}", current.mins, current.secs, total.mins, total.secs));
             ui.text(text, {.padding.left=8, .font_size=28}); }
@@ -630,7 +764,7 @@ Escape)",
             slider_st.fg_color = color::red;
             slider_st.bg_color = color::bg_darker;
 
-            float volume_fraction = (Mix_GetMusicVolume(audio.m_music) / (float)MIX_MAX_VOLUME);
+            float volume_fraction = audio.music_volume();
             ui.begin_row({.stack_direction=StackDirection::Vertical, .gap=20});
 
             Style line{};
@@ -642,8 +776,8 @@ Escape)",
             ui.text("Music", {});
 
             ui.begin_row({.gap=10});
-            ui.slider( m_music_slider, slider_st, volume_fraction, {[](float fraction) {
-                    Mix_VolumeMusic(MIX_MAX_VOLUME * fraction);
+            ui.slider( m_music_slider, slider_st, volume_fraction, {[&](float fraction) {
+                    audio.set_music_volume(fraction);
             }});
             ui.text(ui.strings.add(std::format("{:.0f}%", volume_fraction * 100)), {});
             ui.end_row();
@@ -653,15 +787,26 @@ Escape)",
             ui.text("Effect", {.padding.bottom=10});
 
             ui.begin_row({.gap=10});
-            float effect_fraction = (effect_volume / (float)MIX_MAX_VOLUME);
+            float effect_fraction = audio.effect_volume();
             ui.slider(m_master_slider, slider_st, effect_fraction, SliderCallbacks{[&](float fraction) {
-                effect_volume = MIX_MAX_VOLUME * fraction;
-                Mix_MasterVolume(effect_volume);
+                audio.set_effect_volume(fraction);
             }});
             ui.text(ui.strings.add(std::format("{:.0f}%", effect_fraction * 100)), {});
             ui.end_row();
             ui.end_row();
 
+            ui.begin_row(line);
+            ui.text("Offset", {});
+
+            ui.begin_row({.gap=10});
+            ui.text(ui.strings.add(std::format("{:+.1f} ms", settings.global_offset * 1000)), {});
+            ui.button("Calibrate", {.background_color=color::bg_darker, .padding=even_padding(5)}, [&]() {
+                audio.play_sound(assets.get_sound(SoundID::menu_confirm));
+                event_queue.push_event(Event::Calibrate{});
+            });
+            ui.end_row();
+            ui.end_row();
+
             ui.end_row();
         }
         ui.end_row();
@@ -703,5 +848,12 @@ Escape)",
 
     ui.end_frame(input);
 
-    ui.draw(renderer);
+    // the frame target still holds the last menu frame, only redraw when the ui came out different
+    if (ui.changed(m_last_draw_hash) || damage::invalidated()) {
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
+        SDL_RenderClear(renderer);
+        SDL_RenderTexture(renderer, assets.get_image(ImageID::bg).texture, NULL, NULL);
+        ui.draw(renderer);
+        damage::mark_dirty();
+    }
 }
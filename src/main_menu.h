@@ -1,8 +1,11 @@
 #pragma once
 
+#include <future>
+
 #include "constants.h"
 #include "input.h"
 #include "map.h"
+#include "preview_cache.h"
 #include "systems.h"
 #include "ui.h"
 
@@ -23,7 +26,7 @@ struct Slice {
 
 class MainMenu {
   public:
-    MainMenu(MemoryAllocators& memory, SDL_Renderer* _renderer, Input::Input& _input, Audio& _audio, AssetLoader& _assets, EventQueue& _event_queue);
+    MainMenu(MemoryAllocators& memory, SDL_Renderer* _renderer, Input::Input& _input, Audio& _audio, AssetLoader& _assets, EventQueue& _event_queue, Settings& _settings);
 
     void awake();
     void update(double delta_time);
@@ -31,12 +34,19 @@ class MainMenu {
     void play_selected_music();
 
   private:
+    void update_preview();
+    void update_loudness_jobs();
+    double music_position();
+    double music_duration();
+    void seek_music(double position);
+
     SDL_Renderer* renderer;
     MemoryAllocators& memory;
     Input::Input& input;
     Audio& audio;
     AssetLoader& assets;
     EventQueue& event_queue;
+    Settings& settings;
 
     EntryMode m_entry_mode = EntryMode::Play;
     View m_view = View::Main;
@@ -78,4 +88,22 @@ class MainMenu {
     TextFieldState search{.text = "ashkjfhkjh"};
 
     AnimState m_load_button;
+    UICapacityHints m_ui_hints{};
+    UILayoutCache m_ui_layout{};
+    uint64_t m_last_draw_hash{};
+
+    PreviewCache m_previews;
+    // mapset waiting on its clip to finish decoding
+    std::optional<int> m_pending_preview;
+    // clip thats playing, nullptr once a seek outside it switched to streaming the whole song
+    std::shared_ptr<const PreviewClip> m_preview_clip;
+
+    struct LoudnessJob {
+        std::filesystem::path mapset_directory;
+        std::future<std::optional<double>> result;
+    };
+    std::vector<LoudnessJob> m_loudness_jobs;
+    // whole song being opened after a seek outside the clip
+    MusicLoad m_stream_load;
+    double m_stream_position{};
 };
@@ -1,6 +1,8 @@
 #include "map.h"
+#include <charconv>
 #include <filesystem>
 #include <string>
+#include <string_view>
 
 Map::Map(MapMeta meta_data) : m_meta_data{ meta_data } {}
 
@@ -19,22 +21,35 @@ std::optional<std::filesystem::path> find_music_file(std::filesystem::path mapse
     return {};
 }
 
+#include "allocator.h"
 #include "constants.h"
 #include "serialize.h"
 using namespace constants;
 
-std::vector<std::string> split(const std::string &s, char delim) {
-    std::vector<std::string> result;
-    std::stringstream ss(s);
-    std::string item;
+// views into s, allocated from scratch so the caller owns the scope
+temp::vector<std::string_view> split(linear_allocator& scratch, std::string_view s, char delim) {
+    temp::vector<std::string_view> result(scratch);
 
-    while (getline(ss, item, delim)) {
-        result.push_back(item);
+    size_t start = 0;
+    while (start < s.size()) {
+        size_t end = s.find(delim, start);
+        if (end == std::string_view::npos) {
+            end = s.size();
+        }
+        result.push_back(s.substr(start, end - start));
+        start = end + 1;
     }
 
     return result;
 }
 
+// 0 for anything that isnt a number, same as the old stoi path minus the throw
+int parse_int(std::string_view s) {
+    int value = 0;
+    std::from_chars(s.data(), s.data() + s.size(), value);
+    return value;
+}
+
 std::vector<std::string> split_once(const std::string &s, char delim) {
     std::vector<std::string> result;
     std::stringstream ss(s);
@@ -57,6 +72,8 @@ std::string& ltrim(std::string& s, const char* t = " \t\n\r\f\v")
 int load_osu_map(std::filesystem::path map_file_path, Map& map);
 
 int load_osz(std::filesystem::path osz_file_path) {
+    mem::TagScope tag(MemTag::import);
+
     if (osz_file_path.extension() != ".osz") {
         return 1;
     }
@@ -179,10 +196,14 @@ int load_osu_map(std::filesystem::path map_file_path, Map& map) {
     while (std::getline(file, line) && line.compare("[HitObjects]") != 0) {
     }
     while (std::getline(file, line) && line.size() > 0) {
-        auto values = split(line, ',');
-        map.times.push_back(std::stoi(values[2]) / 1000.0);
+        ScratchScope scratch;
+        auto values = split(scratch.arena, line, ',');
+        if (values.size() < 5) {
+            continue;
+        }
+        map.times.push_back(parse_int(values[2]) / 1000.0);
 
-        int note_type = std::stoi(values[4]);
+        int note_type = parse_int(values[4]);
 
         NoteFlags note_flags{};
 
@@ -30,13 +30,20 @@ struct MapSetInfo {
     std::string artist;
     double preview_time;
 
+    // integrated loudness of the music in LUFS, filled in by a background pass
+    bool loudness_analyzed{};
+    double loudness{};
+
     template<class Archive>
     void serialize(Archive& ar, const uint32_t version) {
         ar(title, artist, preview_time);
+        if (version >= 1) {
+            ar(loudness_analyzed, loudness);
+        }
     }
 };
 
-CEREAL_CLASS_VERSION(MapSetInfo, 0);
+CEREAL_CLASS_VERSION(MapSetInfo, 1);
 
 struct MapMeta {
     std::string difficulty_name;
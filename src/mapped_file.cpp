@@ -0,0 +1,98 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const std::filesystem::path& path) {
+    close();
+
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file = file;
+    m_mapping = mapping;
+    m_data = (const std::byte*)view;
+    m_size = (size_t)size.QuadPart;
+    return true;
+}
+
+void MappedFile::close() {
+    if (m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+        CloseHandle(m_mapping);
+        CloseHandle(m_file);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_file = nullptr;
+    m_mapping = nullptr;
+}
+#else
+bool MappedFile::open(const std::filesystem::path& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps the file alive on its own
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+
+    m_data = (const std::byte*)view;
+    m_size = (size_t)info.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (m_data != nullptr) {
+        munmap((void*)m_data, m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+}
+#endif
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+// read only view of a whole file, unmapped when it goes out of scope
+class MappedFile {
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // false if the file is missing, empty or cant be mapped
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    const std::byte* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+  private:
+    const std::byte* m_data{};
+    size_t m_size{};
+#ifdef _WIN32
+    void* m_file{};
+    void* m_mapping{};
+#endif
+};
@@ -0,0 +1,183 @@
+#include "mem_tags.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <tracy/Tracy.hpp>
+
+namespace {
+
+struct TagCounters {
+    std::atomic<int64_t> live_bytes;
+    std::atomic<int64_t> peak_bytes;
+    std::atomic<uint64_t> frame_allocations;
+    std::atomic<uint64_t> total_allocations;
+};
+
+// plain zero init, operator new can hit these before any constructors have run
+TagCounters counters[mem_tag_count];
+
+thread_local MemTag current = MemTag::general;
+thread_local uint64_t thread_heap_count = 0;
+std::atomic<uint64_t> frame_heap_count;
+
+const char* tag_names[] = {"general", "ui", "map", "audio", "assets", "editor", "import"};
+static_assert(std::size(tag_names) == mem_tag_count);
+
+const char* live_plot_names[] = {"mem general", "mem ui", "mem map", "mem audio", "mem assets", "mem editor", "mem import"};
+const char* alloc_plot_names[] = {"allocs general", "allocs ui", "allocs map", "allocs audio", "allocs assets", "allocs editor", "allocs import"};
+static_assert(std::size(live_plot_names) == mem_tag_count);
+static_assert(std::size(alloc_plot_names) == mem_tag_count);
+
+} // namespace
+
+const char* mem_tag_name(MemTag tag) {
+    return tag_names[(int)tag];
+}
+
+namespace mem {
+
+TagScope::TagScope(MemTag tag) : m_previous(current) {
+    current = tag;
+}
+
+TagScope::~TagScope() {
+    current = m_previous;
+}
+
+MemTag current_tag() {
+    return current;
+}
+
+void charge(MemTag tag, int64_t bytes) {
+    auto& c = counters[(int)tag];
+    int64_t live = c.live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+    int64_t peak = c.peak_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !c.peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+void record_alloc(MemTag tag, size_t size) {
+    charge(tag, (int64_t)size);
+    count_allocation(tag);
+    thread_heap_count++;
+    frame_heap_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void record_free(MemTag tag, size_t size) {
+    charge(tag, -(int64_t)size);
+}
+
+void count_allocation(MemTag tag) {
+    auto& c = counters[(int)tag];
+    c.frame_allocations.fetch_add(1, std::memory_order_relaxed);
+    c.total_allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t thread_heap_allocations() {
+    return thread_heap_count;
+}
+
+uint64_t frame_heap_allocations() {
+    return frame_heap_count.load(std::memory_order_relaxed);
+}
+
+NoAllocScope::NoAllocScope(const char* name) : m_name(name), m_start(thread_heap_count) {}
+
+NoAllocScope::~NoAllocScope() {
+#ifdef ALLOC_TRIPWIRE
+    uint64_t count = allocations();
+    if (count > 0) {
+        std::cerr << std::format("{} heap allocated {} times\n", m_name, count);
+        assert(count == 0);
+    }
+#endif
+}
+
+uint64_t NoAllocScope::allocations() const {
+    return thread_heap_count - m_start;
+}
+
+std::array<MemTagStats, mem_tag_count> stats() {
+    std::array<MemTagStats, mem_tag_count> out{};
+    for (int i = 0; i < mem_tag_count; i++) {
+        out[i] = {
+            counters[i].live_bytes.load(std::memory_order_relaxed),
+            counters[i].peak_bytes.load(std::memory_order_relaxed),
+            counters[i].frame_allocations.load(std::memory_order_relaxed),
+            counters[i].total_allocations.load(std::memory_order_relaxed),
+        };
+    }
+    return out;
+}
+
+void end_frame() {
+    for (int i = 0; i < mem_tag_count; i++) {
+        TracyPlot(live_plot_names[i], counters[i].live_bytes.load(std::memory_order_relaxed));
+        TracyPlot(alloc_plot_names[i], (int64_t)counters[i].frame_allocations.exchange(0, std::memory_order_relaxed));
+    }
+    TracyPlot("heap allocs", (int64_t)frame_heap_count.exchange(0, std::memory_order_relaxed));
+}
+
+std::string dump_json() {
+    auto all = stats();
+
+    std::string json = "{\n";
+    for (int i = 0; i < mem_tag_count; i++) {
+        auto& s = all[i];
+        json += std::format("  \"{}\": {{\"live_bytes\": {}, \"peak_bytes\": {}, \"frame_allocations\": {}, \"total_allocations\": {}}}{}\n",
+            tag_names[i], s.live_bytes, s.peak_bytes, s.frame_allocations, s.total_allocations, i + 1 < mem_tag_count ? "," : "");
+    }
+    json += "}\n";
+
+    return json;
+}
+
+bool write_json(const std::filesystem::path& path) {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+    file << dump_json();
+    return (bool)file;
+}
+
+} // namespace mem
+
+// in front of every global allocation so delete knows what to take the bytes off
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) AllocHeader {
+    std::size_t size;
+    MemTag tag;
+};
+
+void* operator new(std::size_t count)
+{
+    auto header = (AllocHeader*)malloc(sizeof(AllocHeader) + count);
+    if (header == nullptr) {
+        throw std::bad_alloc();
+    }
+    header->size = count;
+    header->tag = mem::current_tag();
+    mem::record_alloc(header->tag, count);
+
+    auto ptr = (void*)(header + 1);
+    TracyAlloc (ptr , count);
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr == nullptr) {
+        return;
+    }
+
+    auto header = (AllocHeader*)ptr - 1;
+    mem::record_free(header->tag, header->size);
+    TracyFree (ptr);
+    free(header);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// which subsystem memory is charged to, general is anything nobody claimed
+enum class MemTag : uint8_t {
+    general,
+    ui,
+    map,
+    audio,
+    assets,
+    editor,
+    import,
+    count,
+};
+
+constexpr int mem_tag_count = (int)MemTag::count;
+
+const char* mem_tag_name(MemTag tag);
+
+struct MemTagStats {
+    int64_t live_bytes;
+    int64_t peak_bytes;
+    // allocations since the last end_frame
+    uint64_t frame_allocations;
+    uint64_t total_allocations;
+};
+
+// counters are relaxed atomics so any thread (jobs, the audio callback) can charge them
+namespace mem {
+
+// tag global new on this thread until the scope ends
+struct TagScope {
+    MemTag m_previous;
+
+    TagScope(MemTag tag);
+    ~TagScope();
+
+    TagScope(const TagScope&) = delete;
+    TagScope& operator=(const TagScope&) = delete;
+};
+
+MemTag current_tag();
+
+// live bytes only, for memory that arrives in bulk (arena commits, pool slabs)
+void charge(MemTag tag, int64_t bytes);
+// allocations that dont change live bytes (arena bumps, pool blocks)
+void count_allocation(MemTag tag);
+
+// charge plus one allocation
+void record_alloc(MemTag tag, size_t size);
+void record_free(MemTag tag, size_t size);
+
+// global new calls (and pool overflow) made by the calling thread, arena bumps dont count
+uint64_t thread_heap_allocations();
+// heap allocations from every thread since the last end_frame
+uint64_t frame_heap_allocations();
+
+// marks code that shouldnt heap allocate on the calling thread. builds with ALLOC_TRIPWIRE log
+// (and assert in debug) when it does, otherwise its just a counter the tests can read
+struct NoAllocScope {
+    const char* m_name;
+    uint64_t m_start;
+
+    NoAllocScope(const char* name);
+    ~NoAllocScope();
+
+    // heap allocations on this thread since the scope opened
+    uint64_t allocations() const;
+
+    NoAllocScope(const NoAllocScope&) = delete;
+    NoAllocScope& operator=(const NoAllocScope&) = delete;
+};
+
+std::array<MemTagStats, mem_tag_count> stats();
+
+// tracy plots for every tag then resets the per frame counts
+void end_frame();
+
+std::string dump_json();
+bool write_json(const std::filesystem::path& path);
+
+} // namespace mem
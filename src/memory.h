@@ -4,6 +4,8 @@
 
 struct MemoryAllocators {
     linear_allocator ui_allocator;
+    // long lived containers that churn (event queue)
+    free_list_allocator pool_allocator;
 };
 
 template<typename T, typename... Args>
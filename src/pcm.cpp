@@ -0,0 +1,362 @@
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cstring>
+#include <tracy/Tracy.hpp>
+
+#include "SDL3_mixer/SDL_mixer.h"
+#include "pcm.h"
+#include "mapped_file.h"
+
+std::shared_ptr<PcmTrack> make_pcm(std::vector<float>&& samples, int channels, int frequency) {
+    auto buffer = std::make_shared<std::vector<float>>(std::move(samples));
+
+    auto track = std::make_shared<PcmTrack>();
+    track->samples = *buffer;
+    track->channels = channels;
+    track->frequency = frequency;
+    track->storage = std::move(buffer);
+
+    return track;
+}
+
+namespace {
+
+// converts to f32 if the mixer isnt already and frees the chunk either way
+std::shared_ptr<PcmTrack> adopt_chunk(Mix_Chunk* chunk, SDL_AudioFormat format, int channels, int frequency) {
+    Uint8* buffer = nullptr;
+    int length = 0;
+
+    if (format == SDL_AUDIO_F32 && chunk->allocated) {
+        // take the chunk's buffer instead of copying a whole song, clearing allocated
+        // stops Mix_FreeChunk from freeing it
+        buffer = chunk->abuf;
+        length = chunk->alen;
+        chunk->allocated = 0;
+    } else {
+        SDL_AudioSpec src_spec{format, channels, frequency};
+        SDL_AudioSpec dst_spec{SDL_AUDIO_F32, channels, frequency};
+
+        if (!SDL_ConvertAudioSamples(&src_spec, chunk->abuf, chunk->alen, &dst_spec, &buffer, &length)) {
+            buffer = nullptr;
+        }
+    }
+
+    Mix_FreeChunk(chunk);
+
+    if (buffer == nullptr) {
+        return nullptr;
+    }
+
+    auto track = std::make_shared<PcmTrack>();
+    track->samples = std::span((float*)buffer, length / sizeof(float));
+    track->channels = channels;
+    track->frequency = frequency;
+    track->storage = std::shared_ptr<void>(buffer, SDL_free);
+
+    return track;
+}
+
+} // namespace
+
+std::shared_ptr<PcmTrack> decode_pcm(const char* file_path) {
+    ZoneScoped;
+
+    int frequency;
+    SDL_AudioFormat format;
+    int channels;
+    if (!Mix_QuerySpec(&frequency, &format, &channels)) {
+        return nullptr;
+    }
+
+    // Mix_LoadWAV runs the same decoders as music and converts to the mixer spec,
+    // it doesnt touch playback state so its fine off the audio thread
+    Mix_Chunk* chunk = Mix_LoadWAV(file_path);
+    if (chunk == nullptr) {
+        return nullptr;
+    }
+
+    return adopt_chunk(chunk, format, channels, frequency);
+}
+
+std::shared_ptr<PcmTrack> decode_pcm(const void* data, size_t size) {
+    ZoneScoped;
+
+    int frequency;
+    SDL_AudioFormat format;
+    int channels;
+    if (!Mix_QuerySpec(&frequency, &format, &channels)) {
+        return nullptr;
+    }
+
+    Mix_Chunk* chunk = Mix_LoadWAV_IO(SDL_IOFromConstMem(data, size), true);
+    if (chunk == nullptr) {
+        return nullptr;
+    }
+
+    return adopt_chunk(chunk, format, channels, frequency);
+}
+
+namespace {
+
+// decoded before the window and thrown away, covers the mp3 bit reservoir and the
+// first vorbis packet after a cut which only primes the overlap
+constexpr double window_preroll = 0.25;
+
+// byte offset where a slice can start and the first sample decoded from there
+struct CutPoint {
+    size_t offset;
+    int64_t sample;
+};
+
+struct StreamIndex {
+    // every place the stream can be cut, ascending
+    std::vector<CutPoint> cuts;
+    // end of the last frame, anything after is tags
+    size_t end{};
+    int64_t total_samples{};
+    int sample_rate{};
+    // goes in front of every slice so the decoder recognises it, ogg headers or an empty id3 tag
+    std::vector<std::byte> prefix;
+};
+
+uint32_t read_le32(const uint8_t* p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+int64_t read_le64(const uint8_t* p) {
+    return (int64_t)((uint64_t)read_le32(p) | (uint64_t)read_le32(p + 4) << 32);
+}
+
+struct Mp3Frame {
+    int size;
+    int samples;
+    int sample_rate;
+    // bytes of side info after the header, a xing tag sits right after it
+    int side_info;
+};
+
+// layer 3 only, thats all anyone ships
+std::optional<Mp3Frame> parse_mp3_frame(const uint8_t* p) {
+    constexpr int mpeg1_bitrates[] = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320};
+    constexpr int mpeg2_bitrates[] = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160};
+    constexpr int sample_rates[] = {44100, 48000, 32000};
+
+    if (p[0] != 0xff || (p[1] & 0xe0) != 0xe0) {
+        return {};
+    }
+
+    // 0 mpeg 2.5, 1 reserved, 2 mpeg 2, 3 mpeg 1
+    int version = (p[1] >> 3) & 3;
+    int layer = (p[1] >> 1) & 3;
+    int bitrate_index = p[2] >> 4;
+    int rate_index = (p[2] >> 2) & 3;
+    if (version == 1 || layer != 1 || bitrate_index == 0 || bitrate_index == 15 || rate_index == 3) {
+        return {};
+    }
+
+    bool mpeg1 = version == 3;
+    bool mono = (p[3] >> 6) == 3;
+    int bitrate = (mpeg1 ? mpeg1_bitrates : mpeg2_bitrates)[bitrate_index] * 1000;
+    int padding = (p[2] >> 1) & 1;
+
+    Mp3Frame frame;
+    frame.samples = mpeg1 ? 1152 : 576;
+    frame.sample_rate = sample_rates[rate_index] >> (mpeg1 ? 0 : version == 2 ? 1 : 2);
+    frame.size = frame.samples / 8 * bitrate / frame.sample_rate + padding;
+    frame.side_info = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+
+    return frame;
+}
+
+std::optional<StreamIndex> index_mp3(const uint8_t* data, size_t size) {
+    size_t offset = 0;
+
+    // id3v2 up front, size is syncsafe and doesnt count the header or footer
+    if (size >= 10 && std::memcmp(data, "ID3", 3) == 0) {
+        offset = 10 + ((data[6] & 0x7f) << 21 | (data[7] & 0x7f) << 14 | (data[8] & 0x7f) << 7 | (data[9] & 0x7f));
+        if (data[5] & 0x10) {
+            offset += 10;
+        }
+    }
+
+    StreamIndex index;
+
+    while (offset + 4 <= size) {
+        auto frame = parse_mp3_frame(data + offset);
+
+        // when not straight after the last frame a sync only counts if another frame follows it,
+        // anything else is junk or a false sync inside tag data so step over it a byte at a time
+        bool valid = frame.has_value() && offset + frame->size <= size &&
+                     (index.sample_rate == 0 || frame->sample_rate == index.sample_rate);
+        bool resyncing = index.cuts.empty() || offset != index.end;
+        if (valid && resyncing && offset + frame->size + 4 <= size) {
+            auto next = parse_mp3_frame(data + offset + frame->size);
+            valid = next.has_value() && next->sample_rate == frame->sample_rate;
+        }
+        if (!valid) {
+            offset++;
+            continue;
+        }
+
+        // xing/info/vbri frame in front of the audio is silent metadata
+        bool info_frame = false;
+        if (index.cuts.empty() && frame->size >= 40) {
+            const uint8_t* tag = data + offset + 4 + frame->side_info;
+            info_frame = std::memcmp(tag, "Xing", 4) == 0 || std::memcmp(tag, "Info", 4) == 0 ||
+                         std::memcmp(data + offset + 36, "VBRI", 4) == 0;
+        }
+
+        if (!info_frame) {
+            index.sample_rate = frame->sample_rate;
+            index.cuts.push_back({offset, index.total_samples});
+            index.total_samples += frame->samples;
+            index.end = offset + frame->size;
+        }
+
+        offset += frame->size;
+    }
+
+    if (index.cuts.empty()) {
+        return {};
+    }
+
+    // slices start mid file so give the decoder an empty tag to sniff instead of a bare frame
+    constexpr uint8_t empty_id3[] = {'I', 'D', '3', 4, 0, 0, 0, 0, 0, 0};
+    index.prefix.resize(sizeof(empty_id3));
+    std::memcpy(index.prefix.data(), empty_id3, sizeof(empty_id3));
+
+    return index;
+}
+
+std::optional<StreamIndex> index_ogg(const uint8_t* data, size_t size) {
+    if (size < 27 || std::memcmp(data, "OggS", 4) != 0) {
+        return {};
+    }
+
+    StreamIndex index;
+
+    const uint32_t serial = read_le32(data + 14);
+    size_t headers_end = 0;
+    // samples finished before the current page
+    int64_t granule = 0;
+
+    size_t offset = 0;
+    while (offset + 27 <= size && std::memcmp(data + offset, "OggS", 4) == 0) {
+        const uint8_t* page = data + offset;
+        const int segments = page[26];
+        if (offset + 27 + segments > size) {
+            break;
+        }
+
+        size_t body = 0;
+        for (int i = 0; i < segments; i++) {
+            body += page[27 + i];
+        }
+
+        const size_t page_size = 27 + segments + body;
+        if (offset + page_size > size) {
+            break;
+        }
+
+        // chained or multiplexed, not worth cutting up
+        if (read_le32(page + 14) != serial) {
+            return {};
+        }
+
+        const int64_t page_granule = read_le64(page + 6);
+
+        if (index.sample_rate == 0) {
+            // identification header, packet type, "vorbis", version, channels, rate
+            const uint8_t* packet = page + 27 + segments;
+            if (body < 16 || packet[0] != 1 || std::memcmp(packet + 1, "vorbis", 6) != 0) {
+                return {};
+            }
+            index.sample_rate = read_le32(packet + 12);
+        }
+
+        // header pages all have granule 0, audio always starts on a fresh page after them
+        if (index.cuts.empty() && page_granule == 0) {
+            headers_end = offset + page_size;
+        } else {
+            // a packet carried over from the previous page cant be decoded without it
+            if ((page[5] & 1) == 0) {
+                index.cuts.push_back({offset, granule});
+            }
+
+            // -1 means no packet finishes on this page
+            if (page_granule != -1) {
+                granule = page_granule;
+            }
+        }
+
+        offset += page_size;
+    }
+
+    if (index.cuts.empty() || index.sample_rate <= 0) {
+        return {};
+    }
+
+    index.end = offset;
+    index.total_samples = granule;
+    index.prefix.resize(headers_end);
+    std::memcpy(index.prefix.data(), data, headers_end);
+
+    return index;
+}
+
+} // namespace
+
+std::optional<PcmWindow> decode_pcm_window(const std::filesystem::path& path, double start, double length) {
+    ZoneScoped;
+
+    MappedFile file;
+    if (!file.open(path)) {
+        return {};
+    }
+
+    const auto* data = (const uint8_t*)file.data();
+    bool ogg = file.size() >= 4 && std::memcmp(data, "OggS", 4) == 0;
+    auto index = ogg ? index_ogg(data, file.size()) : index_mp3(data, file.size());
+    if (!index.has_value()) {
+        return {};
+    }
+
+    const auto& cuts = index->cuts;
+    const double rate = index->sample_rate;
+    const double song_duration = index->total_samples / rate;
+
+    start = std::clamp(start, 0.0, std::max(0.0, song_duration - length));
+
+    auto by_sample = [](int64_t sample, const CutPoint& cut) {
+        return sample < cut.sample;
+    };
+
+    // last cut at or before the preroll, first cut after the window
+    auto first = std::upper_bound(cuts.begin(), cuts.end(), (int64_t)((start - window_preroll) * rate), by_sample);
+    if (first != cuts.begin()) {
+        first--;
+    }
+    auto last = std::upper_bound(first, cuts.end(), (int64_t)((start + length) * rate), by_sample);
+
+    const size_t end_offset = last == cuts.end() ? index->end : last->offset;
+    const int64_t end_sample = last == cuts.end() ? index->total_samples : last->sample;
+
+    std::vector<std::byte> slice(index->prefix.size() + end_offset - first->offset);
+    std::memcpy(slice.data(), index->prefix.data(), index->prefix.size());
+    std::memcpy(slice.data() + index->prefix.size(), data + first->offset, end_offset - first->offset);
+
+    auto track = decode_pcm(slice.data(), slice.size());
+    if (track == nullptr || track->frames() == 0) {
+        return {};
+    }
+
+    // line the decoded audio up from the end, the decoder can drop frames at the start of a
+    // slice when it hasnt got what they reference but it always finishes the last one
+    const double slice_start = end_sample / rate - track->duration();
+
+    int64_t skip = std::clamp<int64_t>((int64_t)((start - slice_start) * track->frequency), 0, track->frames());
+    int64_t keep = std::min<int64_t>(track->frames() - skip, (int64_t)(length * track->frequency));
+    track->samples = track->samples.subspan(skip * track->channels, keep * track->channels);
+
+    return PcmWindow{track, slice_start + (double)skip / track->frequency, song_duration};
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+// fully decoded audio in the mixer format, interleaved f32
+struct PcmTrack {
+    std::span<float> samples;
+    int channels{};
+    int frequency{};
+
+    // whatever samples points into, the adopted decoder buffer or a vector
+    std::shared_ptr<void> storage;
+
+    int64_t frames() const {
+        return samples.size() / channels;
+    }
+
+    double duration() const {
+        return (double)frames() / frequency;
+    }
+};
+
+std::shared_ptr<PcmTrack> make_pcm(std::vector<float>&& samples, int channels, int frequency);
+
+// blocking, decodes the whole file so run it on a worker
+// returns nullptr on failure
+std::shared_ptr<PcmTrack> decode_pcm(const char* file_path);
+
+// same as above from a whole file already in memory
+std::shared_ptr<PcmTrack> decode_pcm(const void* data, size_t size);
+
+struct PcmWindow {
+    std::shared_ptr<PcmTrack> track;
+    // where the track actually starts in the song, cuts only land on frame boundaries
+    double start;
+    double song_duration;
+};
+
+// decodes about [start, start + length) of an mp3 or ogg without touching the rest of the file,
+// shifted back when it would run past the end
+// nullopt if the file isnt something it can cut up
+std::optional<PcmWindow> decode_pcm_window(const std::filesystem::path& path, double start, double length);
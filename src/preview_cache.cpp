@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <cmath>
+#include <tracy/Tracy.hpp>
+
+#include "preview_cache.h"
+#include "jobs.h"
+#include "mem_tags.h"
+#include "map.h"
+
+std::shared_ptr<const PreviewClip> decode_preview(const std::filesystem::path& mapset_directory, double preview_time) {
+    ZoneScoped;
+
+    auto clip = std::make_shared<PreviewClip>();
+
+    auto music_file = find_music_file(mapset_directory);
+    if (!music_file.has_value()) {
+        return clip;
+    }
+    clip->music_file = music_file.value();
+
+    // only decodes the clip itself, the full decode below is for files it cant cut up
+    auto window = decode_pcm_window(clip->music_file, preview_time, preview_clip_length);
+    if (window.has_value()) {
+        clip->start = window->start;
+        clip->song_duration = window->song_duration;
+        clip->pcm = std::move(window->track);
+        return clip;
+    }
+
+    auto track = decode_pcm(clip->music_file.string().data());
+    if (track == nullptr) {
+        return clip;
+    }
+
+    clip->song_duration = track->duration();
+
+    int64_t first = std::clamp<int64_t>((int64_t)(preview_time * track->frequency), 0, track->frames());
+    int64_t last = std::min<int64_t>(track->frames(), first + (int64_t)(preview_clip_length * track->frequency));
+
+    // preview point right at the end, take the tail instead
+    if (last - first < track->frequency) {
+        first = std::max<int64_t>(0, last - (int64_t)(preview_clip_length * track->frequency));
+    }
+
+    clip->start = (double)first / track->frequency;
+    // the clip keeps the whole decode alive otherwise
+    auto window_samples = track->samples.subspan(first * track->channels, (last - first) * track->channels);
+    clip->pcm = make_pcm({window_samples.begin(), window_samples.end()}, track->channels, track->frequency);
+
+    return clip;
+}
+
+PreviewCache::PreviewCache() : m_state(std::make_shared<State>()) {}
+
+// call with the mutex held
+PreviewCache::Entry& PreviewCache::find_or_start(const std::filesystem::path& mapset_directory, double preview_time) {
+    auto& entries = m_state->entries;
+
+    for (auto& entry : entries) {
+        if (entry.mapset_directory == mapset_directory) {
+            return entry;
+        }
+    }
+
+    if (entries.size() >= preview_cache_capacity) {
+        auto oldest = std::min_element(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.last_used < b.last_used;
+        });
+        entries.erase(oldest);
+    }
+
+    entries.push_back({mapset_directory, nullptr, m_state->clock});
+
+    jobs::push([state = m_state, mapset_directory, preview_time]() {
+        mem::TagScope tag(MemTag::audio);
+        auto still_wanted = [&]() {
+            return std::any_of(state->entries.begin(), state->entries.end(), [&](const Entry& entry) {
+                return entry.mapset_directory == mapset_directory;
+            });
+        };
+
+        // scrolled past and evicted before a worker got to it
+        {
+            std::lock_guard lock(state->mutex);
+            if (!still_wanted()) {
+                return;
+            }
+        }
+
+        auto clip = decode_preview(mapset_directory, preview_time);
+
+        std::lock_guard lock(state->mutex);
+        for (auto& entry : state->entries) {
+            if (entry.mapset_directory == mapset_directory) {
+                entry.clip = std::move(clip);
+                break;
+            }
+        }
+    });
+
+    return entries.back();
+}
+
+std::shared_ptr<const PreviewClip> PreviewCache::get(const std::filesystem::path& mapset_directory, double preview_time) {
+    std::lock_guard lock(m_state->mutex);
+
+    auto& entry = find_or_start(mapset_directory, preview_time);
+    entry.last_used = ++m_state->clock;
+
+    return entry.clip;
+}
+
+void PreviewCache::prefetch(const std::filesystem::path& mapset_directory, double preview_time) {
+    std::lock_guard lock(m_state->mutex);
+
+    find_or_start(mapset_directory, preview_time);
+}
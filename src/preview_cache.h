@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "pcm.h"
+
+// seconds of song decoded for each menu preview
+constexpr double preview_clip_length = 30;
+
+// clips are ~10 MB each so only keep a handful around
+constexpr int preview_cache_capacity = 5;
+
+struct PreviewClip {
+    // nullptr if the mapset has no music or it failed to decode
+    std::shared_ptr<const PcmTrack> pcm;
+    // where the clip starts in the song
+    double start{};
+    double song_duration{};
+    std::filesystem::path music_file;
+};
+
+// decodes preview clips on the job pool and keeps the most recently used ones
+class PreviewCache {
+  public:
+    PreviewCache();
+
+    // ready clip or nullptr, in which case a decode is started if there isnt one already
+    std::shared_ptr<const PreviewClip> get(const std::filesystem::path& mapset_directory, double preview_time);
+
+    // same as get but doesnt count as a use
+    void prefetch(const std::filesystem::path& mapset_directory, double preview_time);
+
+  private:
+    struct Entry {
+        std::filesystem::path mapset_directory;
+        std::shared_ptr<const PreviewClip> clip;
+        uint64_t last_used;
+    };
+
+    // shared with the decode jobs so they can outlive the cache
+    struct State {
+        std::mutex mutex;
+        std::vector<Entry> entries;
+        uint64_t clock{};
+    };
+
+    std::shared_ptr<State> m_state;
+
+    Entry& find_or_start(const std::filesystem::path& mapset_directory, double preview_time);
+};
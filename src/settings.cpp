@@ -0,0 +1,21 @@
+#include "settings.h"
+#include "serialize.h"
+
+Settings load_settings() {
+    Settings settings{};
+    if (!std::filesystem::exists(settings_path)) {
+        return settings;
+    }
+
+    try {
+        load_binary(settings, settings_path);
+    } catch (const std::exception&) {
+        return Settings{};
+    }
+
+    return settings;
+}
+
+void save_settings(const Settings& settings) {
+    save_binary(settings, settings_path);
+}
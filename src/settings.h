@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cereal/cereal.hpp>
+
+#include <cstdint>
+#include <filesystem>
+
+const inline std::filesystem::path settings_path{"data/settings"};
+
+// player settings that stick around between runs
+struct Settings {
+    // how late the player hits on average in seconds, taken off every hit before judging
+    double global_offset{};
+    // hits the offset has been averaged over, limits how far one play can move it
+    int offset_samples{};
+
+    template <class Archive>
+    void serialize(Archive& ar, const uint32_t version) {
+        ar(global_offset, offset_samples);
+    }
+};
+
+CEREAL_CLASS_VERSION(Settings, 0);
+
+// defaults if theres no file or it doesnt parse
+Settings load_settings();
+void save_settings(const Settings& settings);
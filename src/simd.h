@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define SIMD_SSE
+#include <immintrin.h>
+#endif
+
+// float loops used by the audio analysis code, sse with a scalar fallback
+namespace simd {
+
+inline void min_max(const float* data, size_t count, float& out_min, float& out_max) {
+    float lo = std::numeric_limits<float>::max();
+    float hi = std::numeric_limits<float>::lowest();
+    size_t i = 0;
+
+#ifdef SIMD_SSE
+    if (count >= 4) {
+        __m128 lo4 = _mm_set1_ps(lo);
+        __m128 hi4 = _mm_set1_ps(hi);
+        for (; i + 4 <= count; i += 4) {
+            __m128 v = _mm_loadu_ps(data + i);
+            lo4 = _mm_min_ps(lo4, v);
+            hi4 = _mm_max_ps(hi4, v);
+        }
+
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, lo4);
+        lo = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+        _mm_store_ps(lanes, hi4);
+        hi = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    }
+#endif
+
+    for (; i < count; i++) {
+        lo = std::min(lo, data[i]);
+        hi = std::max(hi, data[i]);
+    }
+
+    out_min = lo;
+    out_max = hi;
+}
+
+// out[i] = min/max of in[2i], in[2i+1]
+inline void pairwise_min_max(const float* in_mins, const float* in_maxs, size_t out_count, float* out_mins, float* out_maxs) {
+    size_t i = 0;
+
+#ifdef SIMD_SSE
+    for (; i + 4 <= out_count; i += 4) {
+        __m128 a = _mm_loadu_ps(in_mins + i * 2);
+        __m128 b = _mm_loadu_ps(in_mins + i * 2 + 4);
+        __m128 even = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 odd = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(out_mins + i, _mm_min_ps(even, odd));
+
+        a = _mm_loadu_ps(in_maxs + i * 2);
+        b = _mm_loadu_ps(in_maxs + i * 2 + 4);
+        even = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        odd = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(out_maxs + i, _mm_max_ps(even, odd));
+    }
+#endif
+
+    for (; i < out_count; i++) {
+        out_mins[i] = std::min(in_mins[i * 2], in_mins[i * 2 + 1]);
+        out_maxs[i] = std::max(in_maxs[i * 2], in_maxs[i * 2 + 1]);
+    }
+}
+
+inline float dot(const float* a, const float* b, size_t count) {
+    float sum = 0;
+    size_t i = 0;
+
+#ifdef SIMD_SSE
+    __m128 sum4 = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        sum4 = _mm_add_ps(sum4, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, sum4);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+
+    for (; i < count; i++) {
+        sum += a[i] * b[i];
+    }
+
+    return sum;
+}
+
+// compresses the magnitude of each bin (fourth root of power), returns the summed increase over
+// previous and replaces previous with the new frame
+inline float spectral_flux(const float* re, const float* im, float* previous, size_t count) {
+    float flux = 0;
+    size_t i = 0;
+
+#ifdef SIMD_SSE
+    __m128 flux4 = _mm_setzero_ps();
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        __m128 r = _mm_loadu_ps(re + i);
+        __m128 m = _mm_loadu_ps(im + i);
+        __m128 power = _mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(m, m));
+        __m128 compressed = _mm_sqrt_ps(_mm_sqrt_ps(power));
+
+        __m128 prev = _mm_loadu_ps(previous + i);
+        flux4 = _mm_add_ps(flux4, _mm_max_ps(zero, _mm_sub_ps(compressed, prev)));
+        _mm_storeu_ps(previous + i, compressed);
+    }
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, flux4);
+    flux = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+
+    for (; i < count; i++) {
+        float compressed = std::sqrt(std::sqrt(re[i] * re[i] + im[i] * im[i]));
+        flux += std::max(0.0f, compressed - previous[i]);
+        previous[i] = compressed;
+    }
+
+    return flux;
+}
+
+// out[i] += in[i] * gain
+inline void mix_add(float* out, const float* in, size_t count, float gain) {
+    size_t i = 0;
+
+#ifdef SIMD_SSE
+    const __m128 gain4 = _mm_set1_ps(gain);
+    for (; i + 4 <= count; i += 4) {
+        __m128 mixed = _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(in + i), gain4));
+        _mm_storeu_ps(out + i, mixed);
+    }
+#endif
+
+    for (; i < count; i++) {
+        out[i] += in[i] * gain;
+    }
+}
+
+} // namespace simd
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// lock free ring for one producer thread and one consumer thread
+template <typename T, size_t capacity>
+class SpscQueue {
+    static_assert((capacity & (capacity - 1)) == 0, "capacity has to be a power of two");
+
+  public:
+    // false if full
+    bool push(const T& item) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == capacity) {
+            return false;
+        }
+
+        m_items[head & (capacity - 1)] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // false if empty
+    bool pop(T& out) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        out = m_items[tail & (capacity - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+  private:
+    std::array<T, capacity> m_items{};
+
+    // separate cache lines so the two threads dont fight over them
+    alignas(64) std::atomic<size_t> m_head{};
+    alignas(64) std::atomic<size_t> m_tail{};
+};
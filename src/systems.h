@@ -6,6 +6,7 @@
 #include "asset_loader.h"
 #include "assets.h"
 #include "memory.h"
+#include "settings.h"
 
 struct Systems {
     SDL_Renderer* renderer{};
@@ -14,4 +15,5 @@ struct Systems {
     Audio& audio;
     AssetLoader& assets;
     EventQueue& event_queue;
+    Settings& settings;
 };
@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <format>
+#include <numbers>
+#include <tracy/Tracy.hpp>
+
+#include "tempo.h"
+#include "dev_macros.h"
+#include "fft.h"
+#include "jobs.h"
+#include "simd.h"
+
+constexpr int frame_size = 1024;
+constexpr int hop_size = 512;
+constexpr int bin_count = frame_size / 2 + 1;
+
+// onset frames per job
+constexpr int chunk_frames = 1024;
+
+constexpr double min_bpm = 60;
+constexpr double max_bpm = 240;
+// most charts sit around here, breaks ties between half/double tempo
+constexpr double preferred_bpm = 140;
+constexpr double prior_octaves = 1.0;
+
+// how many multiples of the beat period the comb looks at
+constexpr int comb_teeth = 4;
+
+// flux peaks land this far after the attack, the window has to mostly cover it first
+// measured against click tracks, in samples
+constexpr double onset_delay = frame_size * 0.75;
+
+// fills out[0, last - first) with the spectral flux of onset frames [first, last)
+void spectral_flux_chunk(const PcmTrack& track, const FftPlan& plan, const std::vector<float>& window, int64_t first, int64_t last, float* out) {
+    ZoneScoped;
+
+    std::vector<float> re(frame_size);
+    std::vector<float> im(frame_size);
+    std::vector<float> previous(bin_count);
+
+    const int64_t total_frames = track.frames();
+    const float channel_scale = 1.0f / track.channels;
+
+    // start one frame early so the first flux value has something to diff against
+    for (int64_t onset = first - 1; onset < last; onset++) {
+        int64_t start = onset * hop_size;
+        for (int i = 0; i < frame_size; i++) {
+            int64_t frame = start + i;
+            float sample = 0;
+            if (frame >= 0 && frame < total_frames) {
+                const float* src = track.samples.data() + frame * track.channels;
+                for (int c = 0; c < track.channels; c++) {
+                    sample += src[c];
+                }
+                sample *= channel_scale;
+            }
+            re[i] = sample * window[i];
+            im[i] = 0;
+        }
+
+        plan.forward(re.data(), im.data());
+        float flux = simd::spectral_flux(re.data(), im.data(), previous.data(), bin_count);
+
+        if (onset >= first) {
+            out[onset - first] = flux;
+        }
+    }
+}
+
+// envelope minus its local mean, negatives dropped
+std::vector<float> onset_strength(const std::vector<float>& flux, int radius) {
+    const int64_t count = flux.size();
+
+    std::vector<double> prefix(count + 1);
+    for (int64_t i = 0; i < count; i++) {
+        prefix[i + 1] = prefix[i] + flux[i];
+    }
+
+    std::vector<float> onsets(count);
+    for (int64_t i = 0; i < count; i++) {
+        int64_t lo = std::max<int64_t>(0, i - radius);
+        int64_t hi = std::min<int64_t>(count, i + radius + 1);
+        double mean = (prefix[hi] - prefix[lo]) / (hi - lo);
+        onsets[i] = std::max(0.0f, flux[i] - (float)mean);
+    }
+
+    return onsets;
+}
+
+// strength of the envelope at one period, angle gives where in the period the onsets land
+std::complex<double> fold(const std::vector<float>& onsets, double period) {
+    const std::complex<double> step = std::polar(1.0, -2 * std::numbers::pi / period);
+    std::complex<double> rotation = 1;
+    std::complex<double> sum = 0;
+
+    for (size_t t = 0; t < onsets.size(); t++) {
+        if (onsets[t] > 0) {
+            sum += (double)onsets[t] * rotation;
+        }
+        rotation *= step;
+
+        // keep the recurrence from drifting off the unit circle
+        if ((t & 1023) == 1023) {
+            rotation /= std::abs(rotation);
+        }
+    }
+
+    return sum;
+}
+
+struct CombFold {
+    double strength;
+    // where in the period the onsets land, in onset frames
+    double phase;
+};
+
+// fold summed over the comb teeth. a lag that landed on a multiple of the beat cancels at its own
+// period (every other onset is half a turn out), the harmonics still peak there
+CombFold comb_fold(const std::vector<float>& onsets, double period) {
+    CombFold result{};
+    double strongest = -1;
+    for (int k = 1; k <= comb_teeth; k++) {
+        auto folded = fold(onsets, period / k);
+        result.strength += std::abs(folded);
+        if (std::abs(folded) > strongest) {
+            strongest = std::abs(folded);
+            result.phase = -std::arg(folded) / (2 * std::numbers::pi) * period / k;
+        }
+    }
+    return result;
+}
+
+TempoEstimate estimate_tempo(const PcmTrack& track) {
+    ZoneScoped;
+
+    const double rate = (double)track.frequency / hop_size;
+    const int64_t onset_count = track.frames() / hop_size;
+
+    const int min_lag = (int)std::floor(60 * rate / max_bpm);
+    const int max_lag = (int)std::ceil(60 * rate / min_bpm);
+
+    if (track.channels <= 0 || onset_count < max_lag * 2) {
+        return {160, 0};
+    }
+
+    FftPlan plan(frame_size);
+    std::vector<float> window(frame_size);
+    for (int i = 0; i < frame_size; i++) {
+        window[i] = 0.5f - 0.5f * (float)std::cos(2 * std::numbers::pi * i / frame_size);
+    }
+
+    std::vector<float> flux(onset_count);
+    {
+        ZoneScopedN("spectral flux");
+
+        std::vector<std::future<void>> chunks;
+        for (int64_t first = 0; first < onset_count; first += chunk_frames) {
+            int64_t last = std::min<int64_t>(onset_count, first + chunk_frames);
+            chunks.push_back(jobs::submit([&, first, last]() {
+                spectral_flux_chunk(track, plan, window, first, last, flux.data() + first);
+            }));
+        }
+
+        for (auto& chunk : chunks) {
+            jobs::wait(chunk);
+        }
+    }
+
+    // about a quarter second either side
+    auto onsets = onset_strength(flux, (int)(rate * 0.25));
+
+    int best_lag = 0;
+    {
+        ZoneScopedN("autocorrelation");
+
+        // a period between two integer lags splits its peak across both, and the k-th multiple can
+        // be off by up to k / 2 frames, so each tooth sums a window that wide
+        auto tooth_radius = [](int k) { return (k + 1) / 2; };
+        const int max_correlation_lag = max_lag * comb_teeth + tooth_radius(comb_teeth);
+
+        std::vector<double> correlation(max_correlation_lag + 1);
+        for (int lag = std::max(min_lag - 1, 1); lag <= max_correlation_lag && lag < (int)onsets.size(); lag++) {
+            correlation[lag] = simd::dot(onsets.data(), onsets.data() + lag, onsets.size() - lag);
+        }
+
+        double best_score = -1;
+        for (int lag = min_lag; lag <= max_lag; lag++) {
+            double score = 0;
+            for (int k = 1; k <= comb_teeth; k++) {
+                double tooth = 0;
+                for (int j = lag * k - tooth_radius(k); j <= lag * k + tooth_radius(k); j++) {
+                    tooth += correlation[j];
+                }
+                score += tooth / k;
+            }
+
+            double octaves = std::log2(60 * rate / lag / preferred_bpm) / prior_octaves;
+            score *= std::exp(-0.5 * octaves * octaves);
+
+            if (score > best_score) {
+                best_score = score;
+                best_lag = lag;
+            }
+        }
+    }
+
+    // integer lag is only good to a frame, sweep fractional periods around it. a long song needs the
+    // period to a few thousandths of a frame or the beats drift off by the end, so a coarse pass
+    // then a fine one around its best
+    double best_period = best_lag;
+    CombFold best_fold = comb_fold(onsets, best_period);
+    {
+        ZoneScopedN("refine");
+
+        auto sweep = [&](double center, double radius, double step) {
+            for (double period = center - radius; period <= center + radius; period += step) {
+                auto folded = comb_fold(onsets, period);
+                if (folded.strength > best_fold.strength) {
+                    best_fold = folded;
+                    best_period = period;
+                }
+            }
+        };
+        sweep(best_lag, 1.5, 0.05);
+        sweep(best_period, 0.05, 0.002);
+    }
+
+    double phase = best_fold.phase;
+    double beat_seconds = best_period / rate;
+    double offset = (phase * hop_size + onset_delay) / track.frequency;
+    offset = std::fmod(offset, beat_seconds);
+    if (offset < 0) {
+        offset += beat_seconds;
+    }
+
+    TempoEstimate estimate{60 / beat_seconds, offset};
+
+    DEV_LOG(std::format("tempo: {:.2f} bpm, offset {:.3f} s from {:.1f} s of audio\n", estimate.bpm, estimate.offset, track.duration()));
+
+    return estimate;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "pcm.h"
+
+struct TempoEstimate {
+    double bpm;
+    // time of the first beat in seconds, same meaning as MapMeta::offset
+    double offset;
+};
+
+// onset detection (spectral flux) then tempo and phase from the onset envelope
+// blocking, fans the spectrum work out over the job pool so call it from a job
+TempoEstimate estimate_tempo(const PcmTrack& track);
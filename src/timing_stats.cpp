@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cmath>
+
+#include "timing_stats.h"
+
+constexpr int min_offset_samples = 8;
+// median absolute deviation to standard deviation for normally distributed hits
+constexpr double mad_scale = 1.4826;
+constexpr double outlier_mads = 3;
+// past this many hits older ones stop dominating so the offset can still follow a new setup
+constexpr int max_offset_samples = 500;
+
+double median(std::vector<double>& values) {
+    auto middle = values.begin() + values.size() / 2;
+    std::nth_element(values.begin(), middle, values.end());
+    double upper = *middle;
+    if (values.size() % 2 == 1) {
+        return upper;
+    }
+
+    double lower = *std::max_element(values.begin(), middle);
+    return (lower + upper) / 2;
+}
+
+std::optional<OffsetEstimate> estimate_offset(const std::vector<double>& errors) {
+    if (errors.size() < min_offset_samples) {
+        return std::nullopt;
+    }
+
+    std::vector<double> scratch = errors;
+    double center = median(scratch);
+
+    for (size_t i = 0; i < errors.size(); i++) {
+        scratch[i] = std::abs(errors[i] - center);
+    }
+    // floor at a millisecond so a very tight set doesnt reject everything off by a hair
+    double limit = outlier_mads * std::max(mad_scale * median(scratch), 0.001);
+
+    double sum = 0;
+    double square_sum = 0;
+    int used = 0;
+    for (double error : errors) {
+        if (std::abs(error - center) <= limit) {
+            sum += error;
+            square_sum += error * error;
+            used++;
+        }
+    }
+
+    double mean = sum / used;
+    double variance = std::max(0.0, square_sum / used - mean * mean);
+
+    return OffsetEstimate{mean, std::sqrt(variance), used, (int)errors.size() - used};
+}
+
+void refine_offset(Settings& settings, const OffsetEstimate& residual) {
+    int total = settings.offset_samples + residual.used;
+    settings.global_offset += residual.mean * residual.used / total;
+    settings.offset_samples = std::min(total, max_offset_samples);
+}
+
+HitErrorStats hit_error_stats(const std::vector<double>& errors) {
+    HitErrorStats stats{};
+
+    // welford so the variance doesnt need a second pass over the mean
+    double mean = 0;
+    double m2 = 0;
+    const double bin_width = hit_histogram_range * 2 / hit_histogram_bins;
+
+    for (double error : errors) {
+        stats.count++;
+        double delta = error - mean;
+        mean += delta / stats.count;
+        m2 += delta * (error - mean);
+
+        int bin = (int)std::floor((error + hit_histogram_range) / bin_width);
+        bin = std::clamp(bin, 0, hit_histogram_bins - 1);
+        stats.histogram[bin]++;
+        stats.histogram_peak = std::max(stats.histogram_peak, stats.histogram[bin]);
+    }
+
+    stats.mean = mean;
+    stats.stddev = stats.count > 1 ? std::sqrt(m2 / stats.count) : 0;
+    stats.unstable_rate = stats.stddev * 1000 * 10;
+
+    return stats;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <vector>
+
+#include "settings.h"
+
+struct OffsetEstimate {
+    double mean;
+    // standard deviation of the hits that were kept
+    double jitter;
+    int used;
+    int rejected;
+};
+
+// throws out hits further than a few MADs from the median (stray taps, double hits)
+// then mean and spread of the rest, nullopt if theres too little to go on
+std::optional<OffsetEstimate> estimate_offset(const std::vector<double>& errors);
+
+// nudge the global offset by what a play measured with it already applied
+void refine_offset(Settings& settings, const OffsetEstimate& residual);
+
+// 4 ms buckets over the ok window
+constexpr int hit_histogram_bins = 35;
+constexpr double hit_histogram_range = 0.07;
+
+struct HitErrorStats {
+    int count;
+    double mean;
+    double stddev;
+    // stddev in ms times 10
+    double unstable_rate;
+    std::array<int, hit_histogram_bins> histogram;
+    int histogram_peak;
+};
+
+// single pass over the errors, no allocation
+HitErrorStats hit_error_stats(const std::vector<double>& errors);
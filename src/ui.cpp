@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <bit>
 #include <chrono>
 #include <cmath>
 #include <cstdint>
@@ -20,6 +21,148 @@ template <class... Ts> struct overloaded : Ts... {
     using Ts::operator()...;
 };
 
+namespace {
+
+UILayoutStats frame_layout_stats{};
+UILayoutStats last_layout_stats{};
+
+uint64_t hash_mix(uint64_t hash, uint64_t value) {
+    return hash ^ (value + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2));
+}
+
+uint64_t hash_float(uint64_t hash, float value) {
+    return hash_mix(hash, std::bit_cast<uint32_t>(value));
+}
+
+uint64_t hash_vec2(uint64_t hash, Vec2 value) {
+    return hash_float(hash_float(hash, value.x), value.y);
+}
+
+uint64_t hash_padding(uint64_t hash, const Padding& padding) {
+    hash = hash_float(hash, padding.left);
+    hash = hash_float(hash, padding.right);
+    hash = hash_float(hash, padding.top);
+    return hash_float(hash, padding.bottom);
+}
+
+uint64_t hash_scale(uint64_t hash, const Scale::Variant& scale) {
+    hash = hash_mix(hash, scale.index());
+    if (auto* fixed = std::get_if<Scale::Fixed>(&scale)) {
+        hash = hash_float(hash, fixed->value);
+    } else if (auto* min = std::get_if<Scale::Min>(&scale)) {
+        hash = hash_float(hash, min->value);
+    }
+    return hash;
+}
+
+uint64_t hash_position(uint64_t hash, const Position::Variant& position) {
+    hash = hash_mix(hash, position.index());
+    return std::visit(
+        overloaded{
+            [=](Position::Relative relative) { return hash_vec2(hash, relative.offset_position); },
+            [=](Position::Anchor anchor) { return hash_vec2(hash, anchor.position); },
+            [=](Position::Absolute absolute) { return hash_vec2(hash, absolute.position); },
+        },
+        position
+    );
+}
+
+// only the fields that change where things end up
+uint64_t hash_layout_style(const Style& style) {
+    uint64_t hash = 0xcbf29ce484222325;
+    hash = hash_position(hash, style.position);
+    hash = hash_padding(hash, style.padding);
+    hash = hash_scale(hash, style.width);
+    hash = hash_scale(hash, style.height);
+    hash = hash_mix(hash, (uint64_t)style.stack_direction);
+    hash = hash_mix(hash, (uint64_t)style.align_items);
+    hash = hash_mix(hash, (uint64_t)style.justify_items);
+    hash = hash_float(hash, style.gap);
+    return hash;
+}
+
+uint64_t hash_text(uint64_t hash, const char* text, const Style& style) {
+    uint64_t text_hash = 0xcbf29ce484222325;
+    for (const char* c = text; *c != '\0'; c++) {
+        text_hash = (text_hash ^ (uint8_t)*c) * 0x100000001b3;
+    }
+    hash = hash_mix(hash, text_hash);
+    hash = hash_float(hash, style.font_size);
+    hash = hash_mix(hash, (uint64_t)style.text_wrap);
+    return hash_mix(hash, (uint64_t)style.text_align);
+}
+
+} // namespace
+
+UILayoutCache::UILayoutCache() : entries(entry_count), row_positions(max_rows), texts(max_texts) {}
+
+const UILayoutCache::Entry* UILayoutCache::find(uint64_t hash) const {
+    if (!valid) {
+        return nullptr;
+    }
+
+    for (size_t i = hash % entry_count;; i = (i + 1) % entry_count) {
+        auto& entry = entries[i];
+        if (entry.generation != generation) {
+            return nullptr;
+        }
+        if (entry.hash == hash) {
+            return &entry;
+        }
+    }
+}
+
+void UILayoutCache::insert(const Entry& entry) {
+    for (size_t i = entry.hash % entry_count;; i = (i + 1) % entry_count) {
+        auto& slot = entries[i];
+        if (slot.generation != generation) {
+            slot = entry;
+            return;
+        }
+        // identical subtrees lay out the same relative to their root, first one is as good as any
+        if (slot.hash == entry.hash) {
+            return;
+        }
+    }
+}
+
+UILayoutStats ui_layout_stats() {
+    return last_layout_stats;
+}
+
+void ui_layout_end_frame() {
+    TracyPlot("ui subtrees reused", (int64_t)frame_layout_stats.subtrees_reused);
+    TracyPlot("ui rows reused", (int64_t)frame_layout_stats.rows_reused);
+    TracyPlot("ui rows laid out", (int64_t)frame_layout_stats.rows_laid_out);
+    last_layout_stats = frame_layout_stats;
+    frame_layout_stats = {};
+}
+
+ListRange visible_list_range(int item_count, float scroll, const VirtualListStyle& style) {
+    if (item_count <= 0 || style.item_extent <= 0) {
+        return {0, 0};
+    }
+
+    float origin = style.stack_direction == StackDirection::Vertical ? style.origin.y : style.origin.x;
+
+    // item i starts at origin + (i - scroll) * extent, keep the ones overlapping [0, viewport_length)
+    int first = (int)std::floor(scroll - origin / style.item_extent) - style.overscan;
+    int end = (int)std::ceil(scroll + (style.viewport_length - origin) / style.item_extent) + style.overscan;
+
+    first = std::max(first, 0);
+    end = std::min(end, item_count);
+
+    return {first, std::max(end - first, 0)};
+}
+
+Vec2 list_item_position(int index, float scroll, const VirtualListStyle& style) {
+    float offset = ((float)index - scroll) * style.item_extent;
+    if (style.stack_direction == StackDirection::Vertical) {
+        return style.origin + Vec2{0, offset};
+    }
+    return style.origin + Vec2{offset, 0};
+}
+
 const char* StringCache::add(std::string&& string) {
     strings[back] = std::move(string);
     back++;
@@ -30,8 +173,10 @@ void StringCache::clear() {
     back = 0;
 }
 
-UI::UI(linear_allocator& temp_allocator) :
+UI::UI(linear_allocator& temp_allocator, UICapacityHints* hints, UILayoutCache* layout_cache) :
     m_temp_allocator(temp_allocator),
+    m_hints(hints),
+    m_layout_cache(layout_cache),
     m_rects(m_temp_allocator),
     m_draw_rects(m_temp_allocator),
     m_click_rects(m_temp_allocator),
@@ -42,15 +187,41 @@ UI::UI(linear_allocator& temp_allocator) :
     m_texts(m_temp_allocator),
     m_text_field_inputs(m_temp_allocator),
     m_on_click_callbacks(m_temp_allocator),
-    // m_slider_user_callbacks(m_temp_allocator),
-    // m_slider_on_held_callbacks(m_temp_allocator),
-    // m_slider_on_release_callbacks(m_temp_allocator),
-    // m_dropdown_on_select_callbacks(m_temp_allocator), 
+    m_slider_user_callbacks(m_temp_allocator),
+    m_slider_on_click_callbacks(m_temp_allocator),
+    m_slider_on_held_callbacks(m_temp_allocator),
+    m_slider_releases(m_temp_allocator),
+    m_dropdown_on_select_callbacks(m_temp_allocator),
     m_options(m_temp_allocator),
     m_dropdown_clickoff_callbacks(m_temp_allocator),
     m_row_stack(m_temp_allocator),
     m_command_tree(m_temp_allocator)
 {
+    if (m_hints != nullptr) {
+        m_rects.reserve(m_hints->rects);
+        m_draw_rects.reserve(m_hints->draw_rects);
+        m_draw_order.reserve(m_hints->draw_order);
+        m_rows.reserve(m_hints->rows);
+        m_texts.reserve(m_hints->texts);
+        m_click_rects.reserve(m_hints->click_rects);
+        m_on_click_callbacks.reserve(m_hints->on_click_callbacks);
+        m_command_tree.reserve(m_hints->command_tree);
+    }
+}
+
+UI::~UI() {
+    if (m_hints != nullptr) {
+        *m_hints = {
+            m_rects.size(),
+            m_draw_rects.size(),
+            m_draw_order.size(),
+            m_rows.size(),
+            m_texts.size(),
+            m_click_rects.size(),
+            m_on_click_callbacks.size(),
+            m_command_tree.size(),
+        };
+    }
 }
 
 RectID UI::begin_row(const Style& style) {
@@ -58,7 +229,22 @@ RectID UI::begin_row(const Style& style) {
 
     m_rects.push_back(Rect{ {}, {}, });
 
-    m_rows.push_back(Row{(int)m_rects.size() - 1, style});
+    Row row{(int)m_rects.size() - 1, style};
+    row.parent = m_row_stack.size() > 0 ? m_row_stack.back() : -1;
+    row.first_command = m_command_tree.size();
+    row.first_text = m_texts.size();
+    if (m_layout_cache != nullptr) {
+        row.hash = hash_layout_style(style);
+        // fit parent reads the parents size in end_row so it belongs in this subtrees key too
+        bool fit_parent = std::holds_alternative<Scale::FitParent>(style.width) || std::holds_alternative<Scale::FitParent>(style.height);
+        if (fit_parent && row.parent != -1) {
+            auto& parent_style = m_rows[row.parent].style;
+            row.hash = hash_scale(row.hash, parent_style.width);
+            row.hash = hash_scale(row.hash, parent_style.height);
+            row.hash = hash_padding(row.hash, parent_style.padding);
+        }
+    }
+    m_rows.push_back(row);
 
     m_command_tree.push_back(Command::begin_row);
 
@@ -71,13 +257,14 @@ RectID UI::begin_row_button(const Style& style, OnClick&& on_click) {
     ZoneScoped;
 
     if (!on_click) {
-        DEV_PANIC("empty on_click std::function passed\n");
+        DEV_PANIC("empty on_click passed\n");
     }
 
     auto rect_index = this->begin_row(style);
 
     m_on_click_callbacks.push_back(std::move(on_click));
     m_click_rects.push_back({ rect_index, (int)m_on_click_callbacks.size() - 1 });
+    mark_interactive(rect_index);
 
     return rect_index;
 
@@ -116,6 +303,11 @@ void UI::text_headless(const char* text, const Style& style) {
     //     }
     // }();
 
+    if (m_layout_cache != nullptr) {
+        auto& row = m_rows[m_row_stack.back()];
+        row.hash = hash_text(row.hash, text, style);
+    }
+
     m_command_tree.push_back(Command::text);
     m_texts.push_back(Text{
         {},
@@ -260,7 +452,8 @@ float aligned_axis(const Vec2& scale, const StackDirection& stack_direction) {
 void UI::end_row() {
     ZoneScoped;
 
-    Row& row = m_rows[m_row_stack.back()];
+    int row_index = m_row_stack.back();
+    Row& row = m_rows[row_index];
     m_row_stack.pop_back();
     float total_width;
     float total_height;
@@ -329,6 +522,16 @@ void UI::end_row() {
     }
 
     m_command_tree.push_back(Command::end_row);
+
+    row.command_end = m_command_tree.size();
+    row.row_count = m_rows.size() - row_index;
+    row.text_count = m_texts.size() - row.first_text;
+
+    if (m_layout_cache != nullptr && m_row_stack.size() > 0) {
+        auto& parent_row = m_rows[m_row_stack.back()];
+        parent_row.hash = hash_mix(parent_row.hash, row.hash);
+        parent_row.has_absolute |= row.has_absolute || std::holds_alternative<Position::Absolute>(row.style.position);
+    }
 }
 
 struct RowStackFrame {
@@ -371,6 +574,9 @@ void UI::end_frame(Input::Input& input) {
 
     this->end_row();
 
+    m_mouse_pos = input.mouse_pos;
+    m_hit_row = -1;
+
 
     // add open dropdown on top of everything
 
@@ -381,13 +587,15 @@ void UI::end_frame(Input::Input& input) {
     if (m_post_overlay.has_value()) {
         auto& overlay = m_post_overlay.value();
 
+        // hook only has its size so far, the positioning pass puts the menu under it
         auto& hook = m_rects[overlay.rect_hook_index];
         auto g_st = Style{};
-        g_st.position = Position::Absolute{hook.position + Vec2{0, hook.scale.y}};
+        g_st.position = Position::Absolute{};
         g_st.width = Scale::Fixed{hook.scale.x};
         g_st.stack_direction = StackDirection::Vertical;
         g_st.background_color = color::red;
-        this->begin_row(g_st);
+        auto menu_id = this->begin_row(g_st);
+        m_rows[menu_id].below_rect = overlay.rect_hook_index;
         auto& options = *overlay.items;
         for (int i = 0; i < options.size(); i++) {
             auto st = (i == overlay.selected_index) ? active_st : Style{};
@@ -420,8 +628,8 @@ void UI::end_frame(Input::Input& input) {
     int current_text_index = 0;
 
     temp::vector<RowStackFrame> row_stack(m_temp_allocator);
-    for (auto command : m_command_tree) {
-        switch (command) {
+    for (int command_index = 0; command_index < (int)m_command_tree.size(); command_index++) {
+        switch (m_command_tree[command_index]) {
         case Command::begin_row: {
             auto& current_row = m_rows[current_row_index];
             auto& current_rect = m_rects[current_row.rect_index];
@@ -497,9 +705,37 @@ void UI::end_frame(Input::Input& input) {
                 m_draw_rects.push_back(DrawRect{ current_rect, style.background_color, style.border_color });
                 m_draw_order.push_back(DrawCommand::rect);
 
+                new_row.next_position += current_rect.position;
+            } else if (auto* absolute = std::get_if<Position::Absolute>(&current_row.style.position)) {
+                // top level rows after the frame root, the dropdown overlay
+                if (current_row.below_rect.has_value()) {
+                    auto& hook = m_rects[current_row.below_rect.value()];
+                    current_rect.position = hook.position + Vec2{0, hook.scale.y};
+                } else {
+                    current_rect.position = absolute->position;
+                }
+
+                auto style = current_row.style;
+                m_draw_rects.push_back(DrawRect{ current_rect, style.background_color, style.border_color });
+                m_draw_order.push_back(DrawCommand::rect);
+
                 new_row.next_position += current_rect.position;
             }
 
+            hit_test_row(current_row_index);
+
+            // root is placed already, the rest of the subtree is last frames layout moved along with it
+            if (auto* cached = find_cached_layout(current_row)) {
+                replay_layout(current_row_index, *cached);
+                command_index = current_row.command_end - 1;
+                current_text_index += current_row.text_count;
+                current_row_index += current_row.row_count;
+                break;
+            }
+            if (m_layout_cache != nullptr) {
+                frame_layout_stats.rows_laid_out++;
+            }
+
             row_stack.push_back(new_row);
             auto row = row_stack[row_stack.size() - 1];
 
@@ -538,25 +774,35 @@ void UI::end_frame(Input::Input& input) {
         }
     }
 
+    if (m_layout_cache != nullptr) {
+        store_layout();
+    }
+
 
 
     if (input.mouse_up(SDL_BUTTON_LMASK)) {
-        for (auto& callback : m_slider_on_release_callbacks) {
-            callback();
+        for (auto& release : m_slider_releases) {
+            release.state->held = false;
+            if (release.on_release) {
+                m_slider_user_callbacks.push_back(release.on_release);
+            }
         }
     }
 
 
-    for (auto& e : m_click_rects) {
-        auto rect = m_rects[e.rect_index];
-        if (input.mouse_down(SDL_BUTTON_LEFT) && rect_point_intersect(input.mouse_pos, rect.position, rect.scale)) {
-            m_on_click_callbacks[e.on_click_index]();
+    // only the topmost rect under the mouse gets anything, every callback registered on it fires
+    RectID hit = topmost_hit();
+
+    if (hit != -1 && input.mouse_down(SDL_BUTTON_LEFT)) {
+        for (auto& e : m_click_rects) {
+            if (e.rect_index == hit) {
+                m_on_click_callbacks[e.on_click_index]();
+            }
         }
     }
 
     for (auto& e : m_hover_rects) {
-        auto rect = m_rects[e.rect_index];
-        if (rect_point_intersect(input.mouse_pos, rect.position, rect.scale)) {
+        if (e.rect_index == hit) {
             e.anim_state.target_hover = true;
         }
     }
@@ -604,13 +850,116 @@ void UI::end_frame(Input::Input& input) {
         }
 
         if (input.mouse_down(SDL_BUTTON_LEFT)) {
-            auto& rect = m_rects[e.rect_index];
-            e.state->focused = rect_point_intersect(input.mouse_pos, rect.position, rect.scale);
+            e.state->focused = e.rect_index == hit;
         }
     }
 
 }
 
+// rows and rects are pushed together in begin_row so a RectID is also its row index
+void UI::mark_interactive(RectID id) {
+    m_rows[id].interactive = true;
+}
+
+// the positioning pass (and layout replay) hands rows over in draw order, so the last one
+// under the mouse is the one on top. transparent layout rows let the mouse through,
+// anything with a background blocks what's under it
+void UI::hit_test_row(int row_index) {
+    auto& row = m_rows[row_index];
+    if (!row.interactive && row.style.background_color.a == 0) {
+        return;
+    }
+
+    auto& rect = m_rects[row.rect_index];
+    if (rect_point_intersect(m_mouse_pos, rect.position, rect.scale)) {
+        m_hit_row = row_index;
+    }
+}
+
+// labels and other decoration inside a button pass the hit up to the button,
+// -1 when the mouse is over nothing interactive or its covered
+RectID UI::topmost_hit() {
+    for (int i = m_hit_row; i != -1; i = m_rows[i].parent) {
+        if (m_rows[i].interactive) {
+            return m_rows[i].rect_index;
+        }
+    }
+    return -1;
+}
+
+const UILayoutCache::Entry* UI::find_cached_layout(const Row& row) {
+    if (m_layout_cache == nullptr || row.has_absolute) {
+        return nullptr;
+    }
+
+    auto* entry = m_layout_cache->find(row.hash);
+    if (entry == nullptr || entry->row_count != row.row_count || entry->text_count != row.text_count) {
+        return nullptr;
+    }
+    return entry;
+}
+
+// walks the subtrees commands in the same order as the positioning pass so the draw order comes out identical
+void UI::replay_layout(int row_index, const UILayoutCache::Entry& entry) {
+    ZoneScoped;
+
+    auto& root = m_rows[row_index];
+    Vec2 delta = m_rects[root.rect_index].position - m_layout_cache->row_positions[entry.first_row];
+
+    int next_row = 1;
+    int next_text = 0;
+    for (int i = root.first_command + 1; i < root.command_end - 1; i++) {
+        switch (m_command_tree[i]) {
+        case Command::begin_row: {
+            auto& row = m_rows[row_index + next_row];
+            auto& rect = m_rects[row.rect_index];
+            rect.position = m_layout_cache->row_positions[entry.first_row + next_row] + delta;
+
+            m_draw_rects.push_back(DrawRect{ rect, row.style.background_color, row.style.border_color });
+            m_draw_order.push_back(DrawCommand::rect);
+            hit_test_row(row_index + next_row);
+            next_row++;
+        } break;
+        case Command::end_row:
+        break;
+        case Command::text: {
+            auto& cached = m_layout_cache->texts[entry.first_text + next_text];
+            auto& text = m_texts[root.first_text + next_text];
+            text.position = cached.position + delta;
+            text.max_width = cached.max_width;
+
+            m_draw_order.push_back(DrawCommand::text);
+            next_text++;
+        } break;
+        }
+    }
+
+    frame_layout_stats.subtrees_reused++;
+    frame_layout_stats.rows_reused += root.row_count;
+}
+
+void UI::store_layout() {
+    auto& cache = *m_layout_cache;
+    cache.generation++;
+    cache.valid = m_rows.size() <= UILayoutCache::max_rows && m_texts.size() <= UILayoutCache::max_texts;
+    if (!cache.valid) {
+        return;
+    }
+
+    for (int i = 0; i < m_rows.size(); i++) {
+        cache.row_positions[i] = m_rects[m_rows[i].rect_index].position;
+    }
+    for (int i = 0; i < m_texts.size(); i++) {
+        cache.texts[i] = {m_texts[i].position, m_texts[i].max_width};
+    }
+    for (int i = 0; i < m_rows.size(); i++) {
+        auto& row = m_rows[i];
+        if (!row.has_absolute) {
+            cache.insert({row.hash, cache.generation, i, row.row_count, row.first_text, row.text_count});
+        }
+    }
+}
+
 void UI::text_field(TextFieldState* state, Style style) {
     ZoneScoped;
 
@@ -624,6 +973,7 @@ void UI::text_field(TextFieldState* state, Style style) {
         state,
         rect_id
     });
+    mark_interactive(rect_id);
 }
 
 RectID UI::text(const char* text, const Style& style) {
@@ -647,36 +997,35 @@ void UI::slider(Slider& state, SliderStyle style, float fraction, SliderCallback
     container.background_color = style.bg_color;
 
     if (state.held) {
-        m_slider_on_release_callbacks.push_back([&, on_release = std::move(callbacks.on_release)]() {
-            state.held = false;
-            if (on_release.has_value()) {
-                m_slider_user_callbacks.push_back(std::move(on_release.value()));
-            }
-        });
+        m_slider_releases.push_back({&state, callbacks.on_release});
     }
 
 
     auto group = Row{};
     group.style = container;
 
-    m_on_click_callbacks.push_back([&, onclick = std::move(callbacks.on_click)]() {
+    // the users on_click sits in its own list so this closure stays small
+    m_slider_on_click_callbacks.push_back(callbacks.on_click);
+    m_on_click_callbacks.push_back([this, &state, index = (int)m_slider_on_click_callbacks.size() - 1]() {
         state.held = true;
-        if (onclick.has_value()) {
-            m_slider_user_callbacks.push_back(std::move(onclick.value()));
+        if (m_slider_on_click_callbacks[index]) {
+            m_slider_user_callbacks.push_back(m_slider_on_click_callbacks[index]);
         }
     });
 
     auto rect_id = this->begin_row(container);
 
     m_click_rects.push_back({rect_id, (int)m_on_click_callbacks.size() - 1});
+    mark_interactive(rect_id);
     if (state.held) {
-        m_slider_on_held_callbacks.push_back(std::move(callbacks.on_input));
+        m_slider_on_held_callbacks.push_back(callbacks.on_input);
         m_slider_input_rects.push_back({rect_id, (int)m_slider_on_held_callbacks.size() - 1});
     }
 
     auto filling = Style{};
     filling.background_color = style.fg_color;
-    filling.width = Scale::Fixed{style.width * fraction};
+    // whole pixels, so a slowly moving fill (music position) only changes the frame when it visibly moves
+    filling.width = Scale::Fixed{std::round(style.width * fraction)};
     filling.height = Scale::Fixed{style.height};
     // filling.layer = 1;
     this->begin_row(filling);
@@ -693,7 +1042,7 @@ void UI::drop_down_menu(
     int selected_opt_index,
     std::vector<const char*>& options,
     DropDown& state,
-    std::function<void(int)> on_input
+    InlineFunction<void(int)> on_input
 ) {
 
     auto st = Style{};
@@ -704,6 +1053,7 @@ void UI::drop_down_menu(
 
     auto rect_index = this->begin_row(st);
     m_click_rects.push_back({rect_index, (int)m_on_click_callbacks.size() - 1 });
+    mark_interactive(rect_index);
     auto thing = (state.menu_dropped)
                      ? strings.add(std::format("{} \\/", options[selected_opt_index]))
                      : strings.add(std::format("{} <", options[selected_opt_index]));
@@ -712,9 +1062,7 @@ void UI::drop_down_menu(
         state.clicked_last_frame = true;
     });
 
-    m_click_rects.push_back({rect_index, (int)m_on_click_callbacks.size() - 1});
-
-    m_dropdown_on_select_callbacks.push_back(std::move(on_input));
+    m_dropdown_on_select_callbacks.push_back(on_input);
 
     if (state.menu_dropped) {
         m_post_overlay = DropDownOverlay{
@@ -750,21 +1098,30 @@ RectID UI::button(const char* text, Style style, OnClick&& on_click) {
     return rect_index;
 }
 
-SDL_FPoint vec2_to_sdl_fpoint(const Vec2& vec) {
-    return {vec.x, vec.y};
-}
+bool UI::changed(uint64_t& last_hash) {
+    ZoneScoped;
 
-void draw_wire_box(SDL_Renderer* renderer, const SDL_FRect& rect) {
-    SDL_FPoint points[5];
-    const Vec2& pos = {rect.x, rect.y};
-    const Vec2& scale = {rect.w, rect.h};
-    points[0] = vec2_to_sdl_fpoint(pos);
-    points[1] = vec2_to_sdl_fpoint(pos + Vec2{1, 0} * scale);
-    points[2] = vec2_to_sdl_fpoint(pos + scale);
-    points[3] = vec2_to_sdl_fpoint(pos + Vec2{0, 1} * scale);
-    points[4] = points[0];
+    uint64_t hash = 0xcbf29ce484222325;
+    for (auto& rect : m_draw_rects) {
+        hash = hash_vec2(hash, rect.rect.position);
+        hash = hash_vec2(hash, rect.rect.scale);
+        hash = hash_mix(hash, std::bit_cast<uint32_t>(rect.background_color));
+        hash = hash_mix(hash, std::bit_cast<uint32_t>(rect.border_color));
+    }
+    for (auto& text : m_texts) {
+        hash = hash_vec2(hash, text.position);
+        hash = hash_float(hash, text.max_width);
+        hash = hash_mix(hash, std::bit_cast<uint32_t>(text.text_color));
+        hash = hash_text(hash, text.text, {.font_size = text.font_size, .text_wrap = text.wrap});
+    }
+    // interleaving decides what covers what
+    for (auto command : m_draw_order) {
+        hash = hash_mix(hash, (uint64_t)command);
+    }
 
-    SDL_RenderLines(renderer, points, 5);
+    bool same = hash == last_hash;
+    last_hash = hash;
+    return !same;
 }
 
 void UI::draw(SDL_Renderer* renderer) {
@@ -777,28 +1134,15 @@ void UI::draw(SDL_Renderer* renderer) {
 
     int rect_index{};
     int text_index{};
+    int draw_calls{};
     for (auto& type : m_draw_order) {
         switch (type) {
         case DrawCommand::rect: {
-            auto draw_rect = m_draw_rects[rect_index];
+            // goes into the same batch as the text, so order holds without a flush per rect
+            auto& draw_rect = m_draw_rects[rect_index];
             auto& rect = draw_rect.rect;
             auto frect = SDL_FRect{rect.position.x, rect.position.y, rect.scale.x, rect.scale.y};
-
-            {
-                ZoneNamedN(asdf, "draw rect", true);
-
-                auto& bg_color = draw_rect.background_color;
-                SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-                SDL_SetRenderDrawColor(renderer, bg_color.r, bg_color.g, bg_color.b, bg_color.a);
-                SDL_RenderFillRect(renderer, &frect);
-            }
-
-            {
-                ZoneNamedN(askdjh, "draw border", true);
-                auto& color = draw_rect.border_color;
-                SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-                draw_wire_box(renderer, {rect.position.x, rect.position.y, rect.scale.x, rect.scale.y});
-            }
+            draw_calls += Font2::draw_rect(renderer, frect, draw_rect.background_color, draw_rect.border_color);
 
             rect_index++;
         }
@@ -815,5 +1159,8 @@ void UI::draw(SDL_Renderer* renderer) {
 
     }
 
+    draw_calls += Font2::flush_text(renderer);
+    TracyPlot("ui draw calls", (int64_t)draw_calls);
+
     clicked = false;
 }
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <cstdint>
+#include <format>
 #include <functional>
 #include <memory_resource>
 #include <optional>
@@ -12,6 +13,7 @@
 #include "input.h"
 #include "vec.h"
 #include "allocator.h"
+#include "inline_function.h"
 #include "memory.h"
 
 #include <SDL3/SDL.h>
@@ -182,9 +184,11 @@ struct Text {
     float max_width;
 };
 
+using OnClick = InlineFunction<void()>;
+
 struct Button {
     int rect_index;
-    std::function<void()> on_click;
+    OnClick on_click;
 };
 
 enum class Command {
@@ -198,14 +202,27 @@ struct ClickInfo {
     Vec2 scale;
 };
 
-using OnClick = std::function<void()>;
-
 struct Row {
     int rect_index;
     Style style;
 
     AnimState* anim_state;
     int children;
+
+    // subtree bookkeeping for the layout cache, filled in by begin_row/end_row
+    int parent;
+    uint64_t hash;
+    int first_command;
+    int command_end;
+    int first_text;
+    int row_count;
+    int text_count;
+    // an absolute row somewhere below doesnt move with this one, so it cant be replayed
+    bool has_absolute;
+    // has a click, hover or text field rect, gets the mouse when its the topmost hit
+    bool interactive;
+    // top level rows placed right under another rect once thats positioned (dropdown menus)
+    std::optional<int> below_rect;
 };
 
 struct ClickRect {
@@ -246,10 +263,16 @@ struct SliderStyle {
     RGBA border_color;
 };
 
+// on_click and on_release can be left empty
 struct SliderCallbacks {
-    std::function<void(float)> on_input;
-    std::optional<std::function<void()>> on_click;
-    std::optional<std::function<void()>> on_release;
+    InlineFunction<void(float)> on_input;
+    OnClick on_click;
+    OnClick on_release;
+};
+
+struct SliderRelease {
+    Slider* state;
+    OnClick on_release;
 };
 
 struct DropDown {
@@ -276,11 +299,95 @@ enum DrawCommand {
     text,
 };
 
+// how big the frame vectors got last time, so the next UI reserves once instead of doubling
+// its way up through the arena
+struct UICapacityHints {
+    size_t rects{};
+    size_t draw_rects{};
+    size_t draw_order{};
+    size_t rows{};
+    size_t texts{};
+    size_t click_rects{};
+    size_t on_click_callbacks{};
+    size_t command_tree{};
+};
+
+// positioned layout from the last frame, kept by the screen like the capacity hints.
+// rows are keyed by a hash of everything that affects the layout of their subtree,
+// so a subtree that hashes the same as last frame gets its positions copied over
+// (shifted to wherever its root ended up) instead of going through the positioning pass.
+// colors arent hashed since the draw commands read them from this frames styles
+struct UILayoutCache {
+    struct Entry {
+        uint64_t hash;
+        uint32_t generation;
+        int first_row;
+        int row_count;
+        int first_text;
+        int text_count;
+    };
+
+    struct TextLayout {
+        Vec2 position;
+        float max_width;
+    };
+
+    // frames bigger than this just dont get cached
+    static constexpr int max_rows = 4096;
+    static constexpr int max_texts = 4096;
+    static constexpr int entry_count = max_rows * 2;
+
+    // sized once up front so storing a frame never allocates
+    std::vector<Entry> entries;
+    std::vector<Vec2> row_positions;
+    std::vector<TextLayout> texts;
+    // entries from older frames count as empty slots, saves clearing the table
+    uint32_t generation{};
+    bool valid{};
+
+    UILayoutCache();
+
+    const Entry* find(uint64_t hash) const;
+    void insert(const Entry& entry);
+};
+
+// a long run of same sized items along one axis, only the ones near the viewport get built
+struct VirtualListStyle {
+    // where the item at the scroll position goes
+    Vec2 origin;
+    StackDirection stack_direction = StackDirection::Vertical;
+    // item length along the stack direction plus the gap after it
+    float item_extent;
+    // visible length along the stack direction, starting from 0
+    float viewport_length;
+    // extra items built past each edge so things sliding in are already there
+    int overscan = 1;
+};
+
+struct ListRange {
+    int first;
+    int count;
+};
+
+ListRange visible_list_range(int item_count, float scroll, const VirtualListStyle& style);
+Vec2 list_item_position(int index, float scroll, const VirtualListStyle& style);
+
+// totals over every UI with a layout cache
+struct UILayoutStats {
+    int subtrees_reused;
+    int rows_reused;
+    int rows_laid_out;
+};
+
+// last frames counts
+UILayoutStats ui_layout_stats();
+// plots and resets the counts, once a frame after every UI is done
+void ui_layout_end_frame();
+
 class UI {
   public:
-    UI(linear_allocator& temp_allocator);
-
-    UI(UI& other) = default;
+    UI(linear_allocator& temp_allocator, UICapacityHints* hints = nullptr, UILayoutCache* layout_cache = nullptr);
+    ~UI();
 
     void text_field(TextFieldState* state, Style style);
     RectID button(const char* text, Style style, OnClick&& on_click);
@@ -290,13 +397,13 @@ class UI {
         int selected_opt_index,
         std::vector<const char*>&& options,
         DropDown& state,
-        std::function<void(int)> on_input
+        InlineFunction<void(int)> on_input
     );
     void drop_down_menu(
         int selected_opt_index,
         std::vector<const char*>& options,
         DropDown& state,
-        std::function<void(int)> on_input
+        InlineFunction<void(int)> on_input
     );
 
     RectID text(const char* text, const Style& style);
@@ -308,17 +415,43 @@ class UI {
     RectID begin_row_button(const Style& style, OnClick&& on_click);
     RectID begin_row_button_anim(AnimState* anim_state, Style style, const AnimStyle& anim_style, OnClick&& on_click);
 
+    // calls build_item(index, position) for the visible window only, position is where
+    // the item goes (absolute). returns the window so callers can scope locks and loads to it
+    template <typename BuildItem>
+    ListRange virtual_list(int item_count, float scroll, const VirtualListStyle& style, BuildItem&& build_item) {
+        auto range = visible_list_range(item_count, scroll, style);
+        for (int i = range.first; i < range.first + range.count; i++) {
+            build_item(i, list_item_position(i, scroll, style));
+        }
+        return range;
+    }
+
     void begin_frame(int width, int height);
     void end_frame(Input::Input& input);
 
     void draw(SDL_Renderer* renderer);
+    // hashes what draw would put on screen into last_hash, false if its the same as last time.
+    // call after end_frame
+    bool changed(uint64_t& last_hash);
 
     bool clicked = false;
 
     StringCache strings{};
 
+    // formats into the frame arena instead of the heap, good until the arena is cleared
+    template <typename... Args>
+    const char* format(std::format_string<Args...> fmt, Args&&... args) {
+        size_t size = std::formatted_size(fmt, args...);
+        char* out = (char*)m_temp_allocator.allocate(size + 1, 1);
+        std::format_to_n(out, size, fmt, std::forward<Args>(args)...);
+        out[size] = '\0';
+        return out;
+    }
+
   private:
     linear_allocator& m_temp_allocator;
+    UICapacityHints* m_hints;
+    UILayoutCache* m_layout_cache;
 
     int m_screen_width = 0;
     int m_screen_height = 0;
@@ -342,12 +475,13 @@ class UI {
 
 
     //slider callbacks
-    std::vector<std::function<void()>> m_slider_user_callbacks; // slider on_click and on_release
-    std::vector<std::function<void(float)>> m_slider_on_held_callbacks;
-    std::vector<std::function<void()>> m_slider_on_release_callbacks;
+    temp::vector<OnClick> m_slider_user_callbacks; // slider on_click and on_release
+    temp::vector<OnClick> m_slider_on_click_callbacks;
+    temp::vector<InlineFunction<void(float)>> m_slider_on_held_callbacks;
+    temp::vector<SliderRelease> m_slider_releases;
 
     //dropdown callbacks
-    std::vector<std::function<void(int)>> m_dropdown_on_select_callbacks; 
+    temp::vector<InlineFunction<void(int)>> m_dropdown_on_select_callbacks;
 
     temp::vector<const char*> m_options;
     temp::vector<DropDown*> m_dropdown_clickoff_callbacks;
@@ -360,6 +494,18 @@ class UI {
     void text_headless(const char* text, const Style& style);
     void add_parent_scale(Row& row, Vec2 scale);
 
+    void mark_interactive(RectID id);
+    void hit_test_row(int row_index);
+    RectID topmost_hit();
+
+    // row index of the last row in draw order under the mouse that takes or blocks input
+    int m_hit_row = -1;
+    Vec2 m_mouse_pos{};
+
+    const UILayoutCache::Entry* find_cached_layout(const Row& row);
+    void replay_layout(int row_index, const UILayoutCache::Entry& entry);
+    void store_layout();
+
     bool m_begin_frame_called{};
     bool m_end_frame_called{};
 };
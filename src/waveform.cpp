@@ -0,0 +1,148 @@
+#include <cmath>
+#include <tracy/Tracy.hpp>
+
+#include "waveform.h"
+#include "constants.h"
+#include "game.h"
+#include "serialize.h"
+#include "simd.h"
+
+namespace fs = std::filesystem;
+
+void source_key(const fs::path& music_file, uint64_t& size, int64_t& write_time) {
+    std::error_code error;
+    size = fs::file_size(music_file, error);
+    write_time = fs::last_write_time(music_file, error).time_since_epoch().count();
+}
+
+std::shared_ptr<WaveformPeaks> build_waveform(const PcmTrack& track, const fs::path& music_file) {
+    ZoneScoped;
+
+    auto peaks = std::make_shared<WaveformPeaks>();
+    source_key(music_file, peaks->source_size, peaks->source_write_time);
+    peaks->frequency = track.frequency;
+
+    const size_t block_samples = peak_base_block * track.channels;
+    const size_t block_count = (track.samples.size() + block_samples - 1) / block_samples;
+
+    auto& base = peaks->levels.emplace_back();
+    base.mins.resize(block_count);
+    base.maxs.resize(block_count);
+
+    for (size_t i = 0; i < block_count; i++) {
+        size_t offset = i * block_samples;
+        size_t count = std::min(block_samples, track.samples.size() - offset);
+        simd::min_max(track.samples.data() + offset, count, base.mins[i], base.maxs[i]);
+    }
+
+    while (peaks->levels.back().mins.size() > 1) {
+        const auto& prev = peaks->levels.back();
+        size_t pairs = prev.mins.size() / 2;
+        size_t count = (prev.mins.size() + 1) / 2;
+
+        PeakLevel next;
+        next.mins.resize(count);
+        next.maxs.resize(count);
+        simd::pairwise_min_max(prev.mins.data(), prev.maxs.data(), pairs, next.mins.data(), next.maxs.data());
+
+        // odd one out carries up as is
+        if (count > pairs) {
+            next.mins.back() = prev.mins.back();
+            next.maxs.back() = prev.maxs.back();
+        }
+
+        peaks->levels.push_back(std::move(next));
+    }
+
+    return peaks;
+}
+
+std::shared_ptr<WaveformPeaks> load_waveform_cache(const fs::path& mapset_directory, const fs::path& music_file) {
+    ZoneScoped;
+
+    auto path = mapset_directory / waveform_filename;
+    if (!fs::exists(path)) {
+        return nullptr;
+    }
+
+    auto peaks = std::make_shared<WaveformPeaks>();
+    try {
+        load_binary(*peaks, path);
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+
+    uint64_t size;
+    int64_t write_time;
+    source_key(music_file, size, write_time);
+    if (peaks->source_size != size || peaks->source_write_time != write_time || peaks->levels.empty()) {
+        return nullptr;
+    }
+
+    return peaks;
+}
+
+void save_waveform_cache(const WaveformPeaks& peaks, const fs::path& mapset_directory) {
+    save_binary(peaks, mapset_directory / waveform_filename);
+}
+
+void draw_waveform(
+    SDL_Renderer* renderer,
+    linear_allocator& temp_allocator,
+    const WaveformPeaks& peaks,
+    const Cam& cam,
+    float center_y,
+    float half_height,
+    RGBA color
+) {
+    ZoneScoped;
+
+    if (peaks.levels.empty() || peaks.levels[0].mins.empty()) {
+        return;
+    }
+
+    const float screen_center = cam.world_to_screen({0, center_y}).y;
+    const float screen_half_height = cam.world_to_screen_scale(half_height);
+    const int top_level = peaks.levels.size() - 1;
+
+    temp::vector<SDL_FRect> columns(temp_allocator);
+    columns.reserve(constants::window_width);
+
+    for (int x = 0; x < constants::window_width; x++) {
+        double start_frame = cam.screen_to_world({(float)x, 0}).x * peaks.frequency;
+        double end_frame = cam.screen_to_world({(float)x + 1, 0}).x * peaks.frequency;
+        if (end_frame <= 0) {
+            continue;
+        }
+
+        // coarsest level whose entries still fit in the column, so each column reads a couple of entries
+        double entries_per_column = (end_frame - start_frame) / peak_base_block;
+        int level = (entries_per_column > 1) ? (int)std::log2(entries_per_column) : 0;
+        level = std::min(level, top_level);
+
+        const auto& peak_level = peaks.levels[level];
+        double entry_frames = std::ldexp((double)peak_base_block, level);
+        auto first = (int64_t)std::max(0.0, std::floor(start_frame / entry_frames));
+        auto last = (int64_t)std::min((double)peak_level.mins.size(), std::ceil(end_frame / entry_frames));
+        if (first >= last) {
+            continue;
+        }
+
+        float lo = peak_level.mins[first];
+        float hi = peak_level.maxs[first];
+        for (int64_t i = first + 1; i < last; i++) {
+            lo = std::min(lo, peak_level.mins[i]);
+            hi = std::max(hi, peak_level.maxs[i]);
+        }
+
+        columns.push_back(SDL_FRect{
+            (float)x,
+            screen_center - hi * screen_half_height,
+            1,
+            std::max(1.0f, (hi - lo) * screen_half_height),
+        });
+    }
+
+    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+    SDL_RenderFillRects(renderer, columns.data(), columns.size());
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include <cereal/cereal.hpp>
+#include <cereal/types/vector.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "allocator.h"
+#include "color.h"
+#include "pcm.h"
+
+class Cam;
+
+constexpr const char* waveform_filename = "waveform";
+
+// frames covered by one entry of level 0, level k covers peak_base_block << k
+constexpr int peak_base_block = 64;
+
+struct PeakLevel {
+    std::vector<float> mins;
+    std::vector<float> maxs;
+
+    template <class Archive>
+    void serialize(Archive& ar, const uint32_t version) {
+        ar(mins, maxs);
+    }
+};
+
+CEREAL_CLASS_VERSION(PeakLevel, 0);
+
+// min/max pyramid over the decoded track, channels are folded together
+struct WaveformPeaks {
+    // identifies the music file the peaks were built from
+    uint64_t source_size;
+    int64_t source_write_time;
+
+    int frequency;
+    std::vector<PeakLevel> levels;
+
+    template <class Archive>
+    void serialize(Archive& ar, const uint32_t version) {
+        ar(source_size, source_write_time, frequency, levels);
+    }
+};
+
+CEREAL_CLASS_VERSION(WaveformPeaks, 0);
+
+std::shared_ptr<WaveformPeaks> build_waveform(const PcmTrack& track, const std::filesystem::path& music_file);
+
+// nullptr if theres no cache or it was built from a different file
+std::shared_ptr<WaveformPeaks> load_waveform_cache(const std::filesystem::path& mapset_directory, const std::filesystem::path& music_file);
+void save_waveform_cache(const WaveformPeaks& peaks, const std::filesystem::path& mapset_directory);
+
+// one column per screen pixel, center_y and half_height in world units
+void draw_waveform(
+    SDL_Renderer* renderer,
+    linear_allocator& temp_allocator,
+    const WaveformPeaks& peaks,
+    const Cam& cam,
+    float center_y,
+    float half_height,
+    RGBA color
+);
@@ -0,0 +1,289 @@
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "test.h"
+#include "allocator.h"
+#include "events.h"
+#include "inline_function.h"
+#include "map.h"
+#include "mem_tags.h"
+
+template <typename T>
+using pool_ref = alloc_ref<T, free_list_allocator>;
+
+static int64_t live_bytes(MemTag tag) {
+    return mem::stats()[(int)tag].live_bytes;
+}
+
+TEST(allocator_pool_reuse) {
+    free_list_allocator pool;
+
+    // 17 and 32 bytes share the 32 class, a freed block is the next one handed out
+    void* a = pool.allocate(24, 8);
+    pool.deallocate(a, 24, 8);
+    void* b = pool.allocate(17, 8);
+    CHECK(b == a);
+    void* c = pool.allocate(32, 16);
+    CHECK(c != b);
+    CHECK(pool.m_pools[1].live_blocks == 2);
+
+    // a different class gets its own slab and never hands out the 32 byte blocks
+    void* small = pool.allocate(16, 8);
+    void* big = pool.allocate(2048, 16);
+    CHECK(small != a && small != c);
+    CHECK(pool.m_pools[0].live_blocks == 1);
+    CHECK(pool.m_pools[7].live_blocks == 1);
+    CHECK((uintptr_t)big % pool_alignment == 0);
+
+    pool.deallocate(b, 17, 8);
+    pool.deallocate(c, 32, 16);
+    pool.deallocate(small, 16, 8);
+    pool.deallocate(big, 2048, 16);
+    for (auto& class_pool : pool.m_pools) {
+        CHECK(class_pool.live_blocks == 0);
+    }
+    CHECK(pool.m_pools[1].total_blocks == (pool_slab_size - sizeof(free_list_allocator::Slab)) / 32);
+    CHECK(pool.m_large_bytes == 0);
+
+    return true;
+}
+
+struct alignas(64) CacheLine {
+    float values[16];
+};
+
+TEST(allocator_pool_large_and_overaligned) {
+    free_list_allocator pool;
+    pool.m_tag = MemTag::editor;
+    const int64_t before = live_bytes(MemTag::editor);
+
+    {
+        // past the biggest class goes to the heap and is charged to the pool's tag
+        std::vector<double, pool_ref<double>> times(pool);
+        times.reserve(1000);
+        CHECK(pool.m_large_bytes == 1000 * sizeof(double));
+        CHECK(live_bytes(MemTag::editor) - before == (int64_t)(1000 * sizeof(double)));
+
+        // small enough for a class but more aligned than the pool gives, heap as well
+        std::vector<CacheLine, pool_ref<CacheLine>> lines(pool);
+        lines.reserve(2);
+        CHECK((uintptr_t)lines.data() % alignof(CacheLine) == 0);
+        CHECK(pool.m_large_bytes == 1000 * sizeof(double) + 2 * sizeof(CacheLine));
+
+        for (auto& class_pool : pool.m_pools) {
+            CHECK(class_pool.total_blocks == 0);
+        }
+    }
+
+    // deallocate found its way back through the same path with the alignment alloc_ref passed
+    CHECK(pool.m_large_bytes == 0);
+    CHECK(live_bytes(MemTag::editor) == before);
+
+    return true;
+}
+
+TEST(allocator_pool_slab_release) {
+    const int64_t before = live_bytes(MemTag::editor);
+    const size_t per_slab = (pool_slab_size - sizeof(free_list_allocator::Slab)) / 64;
+
+    {
+        free_list_allocator pool;
+        pool.m_tag = MemTag::editor;
+
+        // one past a slab's worth forces a second one
+        std::vector<void*> blocks;
+        for (size_t i = 0; i < per_slab + 1; i++) {
+            blocks.push_back(pool.allocate(64, 16));
+        }
+
+        int slabs = 0;
+        for (auto slab = pool.m_slabs; slab != nullptr; slab = slab->next) {
+            slabs++;
+        }
+        CHECK(slabs == 2);
+        CHECK(pool.m_pools[2].total_blocks == per_slab * 2);
+        CHECK(live_bytes(MemTag::editor) - before == (int64_t)(2 * pool_slab_size));
+
+        // freeing blocks keeps the slabs for reuse, only the destructor gives them back
+        for (void* block : blocks) {
+            pool.deallocate(block, 64, 16);
+        }
+        CHECK(pool.m_pools[2].live_blocks == 0);
+        CHECK(live_bytes(MemTag::editor) - before == (int64_t)(2 * pool_slab_size));
+    }
+
+    CHECK(live_bytes(MemTag::editor) == before);
+
+    return true;
+}
+
+TEST(allocator_temp_vector_grows_in_place) {
+    linear_allocator arena;
+    arena.reserve(1_MiB);
+
+    // the only thing in the arena, every doubling extends the same block
+    temp::vector<int> values(arena);
+    values.push_back(0);
+    const int* first = values.data();
+    for (int i = 1; i < 1000; i++) {
+        values.push_back(i);
+    }
+
+    CHECK(values.data() == first);
+    CHECK(values.capacity() >= 1000);
+    CHECK(arena.m_current == (size_t)((std::byte*)(values.data() + values.capacity()) - arena.m_start));
+    for (int i = 0; i < 1000; i++) {
+        CHECK(values[i] == i);
+    }
+
+    return true;
+}
+
+TEST(allocator_temp_vector_reallocates_below_top) {
+    linear_allocator arena;
+    arena.reserve(1_MiB);
+
+    temp::vector<int> values(arena);
+    for (int i = 0; i < 8; i++) {
+        values.push_back(i);
+    }
+    const int* first = values.data();
+    CHECK(values.capacity() == 8);
+
+    // something else on top, the next growth cant extend and moves to a new block past it
+    temp::vector<int> other(arena);
+    other.push_back(-1);
+    values.push_back(8);
+
+    CHECK(values.data() != first);
+    CHECK((std::byte*)values.data() > (std::byte*)other.data());
+    CHECK(arena.m_current == (size_t)((std::byte*)(values.data() + values.capacity()) - arena.m_start));
+    for (int i = 0; i < 9; i++) {
+        CHECK(values[i] == i);
+    }
+    CHECK(other[0] == -1);
+
+    return true;
+}
+
+template <typename F>
+static double best_ms(int runs, F&& f) {
+    double best = 1e9;
+    for (int run = 0; run < runs; run++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+// the containers the pool could back, each against plain malloc through the default allocator
+TEST(bench_pool_vs_malloc) {
+    free_list_allocator pool;
+    constexpr int rounds = 2000;
+    int64_t checksum = 0;
+
+    // map loads, a times and flags vector grown note by note, a few hundred notes per map
+    constexpr int map_notes = 800;
+    double map_heap = best_ms(3, [&] {
+        for (int round = 0; round < rounds; round++) {
+            std::vector<double> times;
+            std::vector<NoteFlags> flags;
+            for (int i = 0; i < map_notes; i++) {
+                times.push_back(i * 0.25);
+                flags.push_back((NoteFlags)i);
+            }
+            checksum += (int64_t)times.size() + flags.back();
+        }
+    });
+    double map_pool = best_ms(3, [&] {
+        for (int round = 0; round < rounds; round++) {
+            std::vector<double, pool_ref<double>> times(pool);
+            std::vector<NoteFlags, pool_ref<NoteFlags>> flags(pool);
+            for (int i = 0; i < map_notes; i++) {
+                times.push_back(i * 0.25);
+                flags.push_back((NoteFlags)i);
+            }
+            checksum += (int64_t)times.size() + flags.back();
+        }
+    });
+
+    // a frame of button callbacks capturing a few pointers, std::function puts those on the heap
+    constexpr int callbacks = 200;
+    struct Captures {
+        int* target;
+        void* a;
+        void* b;
+        int value;
+    };
+    int clicked = 0;
+    double ui_function = best_ms(3, [&] {
+        for (int round = 0; round < rounds; round++) {
+            std::vector<std::function<void()>> list;
+            list.reserve(callbacks);
+            for (int i = 0; i < callbacks; i++) {
+                Captures captures{&clicked, &list, &round, i};
+                list.emplace_back([captures] { *captures.target += captures.value & 1; });
+            }
+            list[round % callbacks]();
+        }
+    });
+    linear_allocator arena;
+    arena.reserve(64_MiB);
+    double ui_inline = best_ms(3, [&] {
+        for (int round = 0; round < rounds; round++) {
+            temp::vector<InlineFunction<void()>> list(arena);
+            list.reserve(callbacks);
+            for (int i = 0; i < callbacks; i++) {
+                Captures captures{&clicked, &list, &round, i};
+                list.emplace_back([captures] { *captures.target += captures.value & 1; });
+            }
+            list[round % callbacks]();
+            arena.clear();
+        }
+    });
+
+    // menu navigation, a handful of events pushed and drained every frame, the pool side is
+    // EventQueue's storage
+    constexpr int events_per_frame = 4;
+    double events_heap = best_ms(3, [&] {
+        for (int round = 0; round < rounds * 10; round++) {
+            std::queue<EventUnion> events;
+            for (int i = 0; i < events_per_frame; i++) {
+                events.push(Event::Return{});
+            }
+            while (!events.empty()) {
+                checksum += (int64_t)events.front().index();
+                events.pop();
+            }
+        }
+    });
+    double events_pool = best_ms(3, [&] {
+        for (int round = 0; round < rounds * 10; round++) {
+            std::queue<EventUnion, std::deque<EventUnion, pool_ref<EventUnion>>> events{std::deque<EventUnion, pool_ref<EventUnion>>(pool)};
+            for (int i = 0; i < events_per_frame; i++) {
+                events.push(Event::Return{});
+            }
+            while (!events.empty()) {
+                checksum += (int64_t)events.front().index();
+                events.pop();
+            }
+        }
+    });
+
+    std::printf("  map vectors, %d x %d notes: malloc %.2f ms, pool %.2f ms\n", rounds, map_notes, map_heap, map_pool);
+    std::printf("  ui callbacks, %d x %d: std::function %.2f ms, InlineFunction in the arena %.2f ms\n", rounds, callbacks, ui_function, ui_inline);
+    std::printf("  event queue, %d x %d events: malloc %.2f ms, pool %.2f ms\n", rounds * 10, events_per_frame, events_heap, events_pool);
+
+    CHECK(checksum > 0);
+    CHECK(clicked > 0);
+    CHECK(pool.m_large_bytes == 0);
+    for (auto& class_pool : pool.m_pools) {
+        CHECK(class_pool.live_blocks == 0);
+    }
+
+    return true;
+}
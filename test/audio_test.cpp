@@ -0,0 +1,130 @@
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+#include "audio.h"
+#include "jobs.h"
+
+constexpr int test_buffer_frames = default_audio_buffer_frames;
+constexpr int trigger_count = 32;
+
+// one post mix callback, the device took frames [first_frame, first_frame + frames) at start_ns
+struct DeviceBlock {
+    uint64_t start_ns;
+    int64_t first_frame;
+    int64_t frames;
+};
+
+struct LatencyProbe {
+    Audio* audio;
+    // when play_sound was called, 0 when nothing is in flight
+    std::atomic<uint64_t> trigger_ns{};
+    std::atomic<int64_t> latency_frames{-1};
+
+    // audio thread only
+    int64_t stream_frames = 0;
+    std::array<DeviceBlock, 64> blocks{};
+    int64_t block_count = 0;
+
+    // frame the device stream was on at time_ns, the dummy driver plays each block out over the
+    // period after its callback with nothing queued behind it
+    int64_t stream_position(uint64_t time_ns) const {
+        for (int64_t i = block_count - 1; i >= std::max<int64_t>(0, block_count - (int64_t)blocks.size()); i--) {
+            auto& block = blocks[i % blocks.size()];
+            if (block.start_ns <= time_ns) {
+                int64_t into = (int64_t)((time_ns - block.start_ns) * mixer_frequency / 1'000'000'000);
+                return block.first_frame + std::min(into, block.frames);
+            }
+        }
+        return -1;
+    }
+};
+
+// runs the real effects mix, then finds the frame of the device stream the sound starts on
+static void probe_hook(void* userdata, Uint8* stream, int length) {
+    auto probe = (LatencyProbe*)userdata;
+    const uint64_t now = SDL_GetTicksNS();
+    const int64_t frames = length / (sizeof(float) * mixer_channels);
+
+    Audio::effects_hook(probe->audio, stream, length);
+
+    probe->blocks[probe->block_count % probe->blocks.size()] = {now, probe->stream_frames, frames};
+    probe->block_count++;
+
+    const uint64_t trigger = probe->trigger_ns;
+    if (trigger != 0) {
+        const auto* out = (const float*)stream;
+        for (int64_t i = 0; i < frames; i++) {
+            if (out[i * mixer_channels] != 0) {
+                int64_t triggered_at = probe->stream_position(trigger);
+                if (triggered_at >= 0) {
+                    probe->latency_frames = probe->stream_frames + i - triggered_at;
+                }
+                probe->trigger_ns = 0;
+                break;
+            }
+        }
+    }
+
+    probe->stream_frames += frames;
+}
+
+TEST(audio_trigger_latency) {
+    SDL_SetHint(SDL_HINT_AUDIO_DRIVER, "dummy");
+    CHECK(SDL_Init(SDL_INIT_AUDIO));
+    jobs::init(1);
+
+    std::vector<int64_t> latencies;
+    {
+        Audio audio{test_buffer_frames};
+
+        // short flat click, anything non zero after the mix is the sound
+        auto click = make_pcm(std::vector<float>(64 * mixer_channels, 0.5f), mixer_channels, mixer_frequency);
+
+        LatencyProbe probe{&audio};
+        Mix_SetPostMix(probe_hook, &probe);
+
+        for (int i = 0; i < trigger_count; i++) {
+            // spread the triggers over different points in the device period
+            std::this_thread::sleep_for(std::chrono::microseconds(1000 + i * 731));
+
+            probe.latency_frames = -1;
+            probe.trigger_ns = SDL_GetTicksNS();
+            audio.play_sound(click.get());
+
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            while (probe.latency_frames < 0 && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            if (probe.latency_frames >= 0) {
+                latencies.push_back(probe.latency_frames);
+            }
+        }
+
+        Mix_SetPostMix(nullptr, nullptr);
+        Mix_CloseAudio();
+    }
+
+    jobs::shutdown();
+    SDL_Quit();
+
+    CHECK(latencies.size() == trigger_count);
+
+    std::sort(latencies.begin(), latencies.end());
+    int64_t median = latencies[latencies.size() / 2];
+    std::printf("  trigger to sample in the device stream: min %lld, median %lld (%.2f ms), worst %lld frames, %d frame buffer\n",
+        (long long)latencies.front(), (long long)median, median * 1000.0 / mixer_frequency, (long long)latencies.back(), test_buffer_frames);
+
+    // a trigger waits for the next callback and starts at the top of that block, so it lands within
+    // a period of where the stream was. a real device adds its own queue on top, the dummy has none
+    CHECK(latencies.front() >= 0);
+    CHECK(median <= test_buffer_frames);
+    // slack for a busy machine waking the callback late
+    CHECK(latencies.back() <= 4 * test_buffer_frames);
+
+    return true;
+}
@@ -0,0 +1,125 @@
+#include <SDL3/SDL.h>
+#include <chrono>
+#include <filesystem>
+
+#include "test.h"
+#include "game.h"
+#include "font.h"
+#include "damage.h"
+#include "jobs.h"
+#include "mem_tags.h"
+#include "serialize.h"
+
+using namespace std::chrono_literals;
+
+constexpr int warmup_frames = 120;
+constexpr int measured_frames = 1800;
+constexpr std::chrono::duration<double> frame_time = 1s / 240.0;
+
+const std::filesystem::path test_mapset_directory{"temp/alloc_test_mapset"};
+
+// no music in the folder so the clock is the lead in, which runs from a second before the first
+// note up to 0. every note sits in that window so autoplay hits all of them
+static void write_test_mapset() {
+    std::filesystem::create_directories(test_mapset_directory);
+
+    Map map{};
+    for (int i = 0; i < 25; i++) {
+        map.times.push_back(-9.0 + i * 0.25);
+        map.flags_list.push_back(i % 2 == 0 ? NoteFlagBits::don : 0);
+    }
+    save_binary(map, test_mapset_directory / "test.tko");
+
+    MapSetInfo info{};
+    info.title = "alloc test";
+    save_binary(info, test_mapset_directory / constants::mapset_filename);
+}
+
+TEST(game_alloc_steady_state) {
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "dummy");
+    SDL_SetHint(SDL_HINT_AUDIO_DRIVER, "dummy");
+    CHECK(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO));
+    jobs::init(1);
+
+    constants::window_width = 1280;
+    constants::window_height = 720;
+
+    SDL_Surface* surface = SDL_CreateSurface(constants::window_width, constants::window_height, SDL_PIXELFORMAT_ABGR8888);
+    SDL_Renderer* renderer = SDL_CreateSoftwareRenderer(surface);
+    CHECK(renderer != nullptr);
+
+    write_test_mapset();
+
+    uint64_t allocations = 0;
+    {
+        Input::Input input{};
+        input.init_keybinds(Input::default_keybindings);
+        Audio audio{};
+        Font2::init_fonts(renderer);
+
+        std::vector<SoundLoadInfo> sound_list = {
+            {"don.wav", SoundID::don, 0.7f},
+            {"kat.wav", SoundID::kat, 0.7f},
+            {"menu_select.wav", SoundID::menu_select},
+            {"menu_confirm.wav", SoundID::menu_confirm},
+            {"menu_back.wav", SoundID::menu_back},
+        };
+
+        std::vector<ImageLoadInfo> image_list = {
+            {"hit_effect_ok.png", ImageID::hit_effect_ok},
+            {"hit_effect_perfect.png", ImageID::hit_effect_perfect},
+            {"circle-overlay.png", ImageID::circle_overlay},
+            {"circle-select.png", ImageID::select_circle},
+            {"circle.png", ImageID::kat_circle, RGBA{60, 219, 226, 255}},
+            {"circle.png", ImageID::don_circle, RGBA{252, 78, 60, 255}},
+            {"drum_inner.png", ImageID::inner_drum},
+            {"drum_outer.png", ImageID::outer_drum},
+            {"circle.png", ImageID::crosshair_fill, RGBA{59, 59, 59, 255}},
+            {"approach_circle.png", ImageID::crosshair_rim, RGBA{110, 110, 110, 255}},
+            {"approach_circle.png", ImageID::crosshair_rim_outer, RGBA{59, 59, 59, 255}},
+            {"bg.png", ImageID::bg},
+            {"bar-left.png", ImageID::back_frame},
+        };
+
+        AssetLoader assets{};
+        assets.init(renderer, image_list, sound_list);
+
+        Settings settings{};
+        MemoryAllocators memory{};
+        memory.ui_allocator.reserve(64_MiB, MemTag::ui);
+        EventQueue event_queue{memory.pool_allocator};
+
+        Systems systems{renderer, memory, input, audio, assets, event_queue, settings};
+        game::Game game(systems, {.mapset_directory = test_mapset_directory, .map_filename = "test.tko", .auto_mode = true, .test_mode = true});
+
+        // same per frame order as the main loop, the first frames load the map and grow the caches
+        for (int frame = 0; frame < warmup_frames + measured_frames; frame++) {
+            damage::begin_frame();
+            input.begin_frame();
+
+            uint64_t before = mem::thread_heap_allocations();
+            game.update(frame_time);
+            if (frame >= warmup_frames) {
+                allocations += mem::thread_heap_allocations() - before;
+            }
+
+            input.end_frame();
+            memory.ui_allocator.clear();
+            Font2::end_frame();
+            ui_layout_end_frame();
+            mem::end_frame();
+            damage::end_frame();
+        }
+    }
+
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroySurface(surface);
+    jobs::shutdown();
+    SDL_Quit();
+    std::filesystem::remove_all(test_mapset_directory);
+
+    std::printf("  Game::update heap allocations over %d frames: %llu\n", measured_frames, (unsigned long long)allocations);
+    CHECK(allocations == 0);
+
+    return true;
+}
@@ -0,0 +1,107 @@
+#include <SDL3/SDL.h>
+#include <chrono>
+#include <format>
+#include <string>
+#include <vector>
+
+#include "test.h"
+#include "ui.h"
+#include "font.h"
+
+constexpr int carousel_entries = 5000;
+constexpr int measured_frames = 60;
+
+// the whole mapset list laid out like the song select carousel, title over artist in every entry
+static void carousel_frame(linear_allocator& arena, UICapacityHints& hints, Input::Input& input, const std::vector<std::string>& titles, const std::vector<std::string>& artists) {
+    UI ui(arena, &hints);
+    ui.begin_frame(1280, 720);
+
+    Style list_st{};
+    list_st.stack_direction = StackDirection::Vertical;
+    list_st.gap = 20;
+    ui.begin_row(list_st);
+
+    for (int i = 0; i < carousel_entries; i++) {
+        Style item_st{};
+        item_st.stack_direction = StackDirection::Vertical;
+        item_st.width = Scale::Fixed{800};
+        item_st.height = Scale::Fixed{120};
+        item_st.padding = even_padding(25);
+
+        Style title_st{};
+        title_st.width = Scale::FitParent{};
+        auto artist_st = title_st;
+        artist_st.font_size = 28;
+
+        ui.begin_row(item_st);
+        ui.text(titles[i].c_str(), title_st);
+        ui.text(artists[i].c_str(), artist_st);
+        ui.end_row();
+    }
+
+    ui.end_row();
+    ui.end_frame(input);
+    Font2::end_frame();
+    arena.clear();
+}
+
+// measure_text only needs the atlas tables, so this runs on the real fonts with no renderer
+TEST(bench_layout_carousel) {
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "dummy");
+    CHECK(SDL_Init(SDL_INIT_VIDEO));
+    Font2::init_font_metrics();
+
+    std::vector<std::string> titles;
+    std::vector<std::string> artists;
+    for (int i = 0; i < carousel_entries; i++) {
+        titles.push_back(std::format("Song Title Number {} (TV Size)", i));
+        // some outside ascii so the glyph metrics path is in there too
+        artists.push_back(i % 10 == 0 ? std::format("アーティスト {}", i) : std::format("Artist {} feat. Someone", i));
+    }
+
+    {
+        Input::Input input{};
+        input.begin_frame();
+        linear_allocator arena;
+        arena.reserve(1_GiB, MemTag::ui);
+        UICapacityHints hints{};
+
+        // first frame measures every string, after that they all come out of the cache
+        auto start = std::chrono::steady_clock::now();
+        carousel_frame(arena, hints, input, titles, artists);
+        double cold_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        double best_ms = 1e9;
+        double total_ms = 0;
+        for (int frame = 0; frame < measured_frames; frame++) {
+            auto frame_start = std::chrono::steady_clock::now();
+            carousel_frame(arena, hints, input, titles, artists);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start).count();
+            best_ms = std::min(best_ms, ms);
+            total_ms += ms;
+        }
+
+        // the measuring on its own, what the cache takes off a frame
+        double measure_ms = 1e9;
+        for (int frame = 0; frame < measured_frames; frame++) {
+            auto frame_start = std::chrono::steady_clock::now();
+            float width = 0;
+            for (int i = 0; i < carousel_entries; i++) {
+                width += Font2::text_dimensions(titles[i].c_str(), 36).x;
+                width += Font2::text_dimensions(artists[i].c_str(), 28).x;
+            }
+            Font2::end_frame();
+            measure_ms = std::min(measure_ms, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start).count());
+            CHECK(width > 0);
+        }
+
+        std::printf("  layout: %d carousel entries, first frame %.2f ms, then best %.2f ms, mean %.2f ms, arena peak %.2f MiB\n",
+            carousel_entries, cold_ms, best_ms, total_ms / measured_frames, (double)arena.m_high_water / 1_MiB);
+        std::printf("  text_dimensions alone: %d strings in %.2f ms\n", 2 * carousel_entries, measure_ms);
+        CHECK(hints.texts >= 2 * carousel_entries);
+    }
+
+    SDL_Quit();
+
+    return true;
+}
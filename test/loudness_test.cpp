@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numbers>
+
+#include "test.h"
+#include "loudness.h"
+
+// stereo with the sine on the left only, right stays silent
+static std::shared_ptr<PcmTrack> left_sine(int frequency, double seconds, double amplitude, double hz = 997) {
+    const int64_t frames = (int64_t)(seconds * frequency);
+    std::vector<float> samples(frames * 2);
+    for (int64_t i = 0; i < frames; i++) {
+        samples[i * 2] = (float)(amplitude * std::sin(2 * std::numbers::pi * hz * i / frequency));
+    }
+    return make_pcm(std::move(samples), 2, frequency);
+}
+
+// bs.1770 calibration, a 997 Hz sine at -20 dBFS on one channel reads -23.01 LUFS
+// at 997 Hz the k weighting is about +0.69 dB, which the -0.691 offset cancels
+TEST(loudness_sine_reference) {
+    for (int frequency : {44100, 48000}) {
+        auto loudness = integrated_loudness(*left_sine(frequency, 20, 0.1));
+        CHECK(loudness.has_value());
+        std::printf("  %d Hz: %.3f LUFS\n", frequency, loudness.value());
+        CHECK(std::abs(loudness.value() - -23.01) < 0.05);
+    }
+
+    return true;
+}
+
+// a quiet stretch 30 dB down falls under the relative gate and doesnt pull the result
+TEST(loudness_relative_gate) {
+    const int frequency = 48000;
+    auto loud = left_sine(frequency, 10, 0.1);
+    auto quiet = left_sine(frequency, 10, 0.1 / 31.6);
+
+    std::vector<float> samples(loud->samples.begin(), loud->samples.end());
+    samples.insert(samples.end(), quiet->samples.begin(), quiet->samples.end());
+    auto loudness = integrated_loudness(*make_pcm(std::move(samples), 2, frequency));
+
+    CHECK(loudness.has_value());
+    CHECK(std::abs(loudness.value() - -23.01) < 0.1);
+
+    return true;
+}
+
+TEST(loudness_silence) {
+    CHECK(!integrated_loudness(*left_sine(44100, 5, 0)).has_value());
+    // below the -70 LUFS absolute gate counts as silence too
+    CHECK(!integrated_loudness(*left_sine(44100, 5, 0.00001)).has_value());
+
+    return true;
+}
+
+TEST(loudness_gain_only_turns_down) {
+    MapSetInfo loud{};
+    loud.loudness_analyzed = true;
+    loud.loudness = target_loudness + 6;
+    CHECK(std::abs(loudness_gain(loud) - std::pow(10.0f, -6 / 20.0f)) < 1e-5f);
+
+    MapSetInfo quiet{};
+    quiet.loudness_analyzed = true;
+    quiet.loudness = target_loudness - 6;
+    CHECK(loudness_gain(quiet) == 1);
+
+    CHECK(loudness_gain(MapSetInfo{}) == 1);
+
+    return true;
+}
+
+// analysis runs in the background per mapset, how many seconds of audio one core gets through
+TEST(bench_loudness_5min) {
+    const int frequency = 44100;
+    const double seconds = 5 * 60;
+    auto track = left_sine(frequency, seconds, 0.3, 440);
+
+    double best = 1e9;
+    for (int run = 0; run < 3; run++) {
+        auto start = std::chrono::steady_clock::now();
+        auto loudness = integrated_loudness(*track);
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        CHECK(loudness.has_value());
+    }
+
+    std::printf("  loudness: 300 s stereo 44.1 kHz in %.1f ms, %.0fx realtime\n", best * 1000, seconds / best);
+
+    return true;
+}
@@ -0,0 +1,45 @@
+#include <cstring>
+#include <vector>
+
+#include "test.h"
+
+struct TestCase {
+    const char* name;
+    TestFn fn;
+};
+
+static std::vector<TestCase>& test_cases() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+int register_test(const char* name, TestFn fn) {
+    test_cases().push_back({name, fn});
+    return 0;
+}
+
+// taiko_tests [prefix], runs every test whose name starts with prefix
+int main(int argc, char** argv) {
+    const char* prefix = argc > 1 ? argv[1] : "";
+
+    int ran = 0;
+    int failed = 0;
+    for (const auto& test : test_cases()) {
+        if (std::strncmp(test.name, prefix, std::strlen(prefix)) != 0) {
+            continue;
+        }
+
+        bool passed = test.fn();
+        std::printf("%s %s\n", passed ? "pass" : "FAIL", test.name);
+
+        ran++;
+        failed += !passed;
+    }
+
+    if (ran == 0) {
+        std::fprintf(stderr, "no tests match '%s'\n", prefix);
+        return 1;
+    }
+
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numbers>
+
+#include "test.h"
+#include "jobs.h"
+#include "tempo.h"
+
+constexpr int frequency = 44100;
+constexpr int channels = 2;
+
+// short decaying 2 kHz blips on every beat starting at offset
+static std::shared_ptr<PcmTrack> click_track(double bpm, double offset, double seconds) {
+    const int64_t frames = (int64_t)(seconds * frequency);
+    const double beat = 60 / bpm;
+    const int click_frames = frequency / 50;
+
+    std::vector<float> samples(frames * channels);
+    for (double time = offset; time < seconds; time += beat) {
+        int64_t first = (int64_t)std::round(time * frequency);
+        for (int i = 0; i < click_frames && first + i < frames; i++) {
+            float envelope = (float)std::exp(-8.0 * i / click_frames);
+            float sample = 0.5f * envelope * (float)std::sin(2 * std::numbers::pi * 2000 * i / frequency);
+            for (int c = 0; c < channels; c++) {
+                samples[(first + i) * channels + c] = sample;
+            }
+        }
+    }
+
+    return make_pcm(std::move(samples), channels, frequency);
+}
+
+// distance between two beat phases, wrapping around the beat
+static double phase_error(double a, double b, double beat) {
+    double error = std::fmod(std::abs(a - b), beat);
+    return std::min(error, beat - error);
+}
+
+static bool check_click_track(double bpm, double offset) {
+    jobs::init(2);
+    auto estimate = estimate_tempo(*click_track(bpm, offset, 30));
+    jobs::shutdown();
+
+    std::printf("  %.1f bpm @ %.3f s -> %.2f bpm @ %.3f s\n", bpm, offset, estimate.bpm, estimate.offset);
+
+    CHECK(std::abs(estimate.bpm - bpm) < 0.5);
+    // onsets are found on a 512 sample hop so this is about as close as it gets,
+    // still well inside the perfect window
+    CHECK(phase_error(estimate.offset, offset, 60 / bpm) < 0.01);
+
+    return true;
+}
+
+TEST(tempo_click_120) {
+    return check_click_track(120, 0.25);
+}
+
+TEST(tempo_click_174) {
+    return check_click_track(174, 0.1);
+}
+
+TEST(tempo_click_90) {
+    return check_click_track(90, 0.6);
+}
+
+TEST(tempo_click_fractional) {
+    return check_click_track(143.5, 0.043);
+}
+
+// 34.45 onset frames, halfway between two integer lags
+TEST(tempo_click_between_lags) {
+    return check_click_track(150, 0.2);
+}
+
+// the editor runs this on a worker, a 5 minute song has to come back well under a second on one
+TEST(bench_tempo_5min) {
+    auto track = click_track(150.3, 0.2, 5 * 60);
+
+    jobs::init(1);
+    double best_ms = 1e9;
+    TempoEstimate estimate{};
+    for (int run = 0; run < 3; run++) {
+        auto start = std::chrono::steady_clock::now();
+        estimate = estimate_tempo(*track);
+        best_ms = std::min(best_ms, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    jobs::shutdown();
+
+    std::printf("  tempo: 300 s stereo 44.1 kHz on one worker in %.1f ms -> %.2f bpm\n", best_ms, estimate.bpm);
+    CHECK(std::abs(estimate.bpm - 150.3) < 0.5);
+    // 750 beats in, a period error shows up as phase drift
+    CHECK(phase_error(estimate.offset, 0.2, 60 / 150.3) < 0.01);
+
+    return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdio>
+
+// bare bones harness so the tests dont pull in a framework
+// each test returns false on the first failed check
+
+using TestFn = bool (*)();
+
+int register_test(const char* name, TestFn fn);
+
+#define TEST(name)                                                                                 \
+    static bool name();                                                                            \
+    static int name##_registered = register_test(#name, name);                                     \
+    static bool name()
+
+#define CHECK(condition)                                                                           \
+    if (!(condition)) {                                                                            \
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);         \
+        return false;                                                                              \
+    }
@@ -0,0 +1,93 @@
+#include <cmath>
+#include <numeric>
+
+#include "test.h"
+#include "timing_stats.h"
+
+static bool near(double a, double b, double tolerance = 1e-9) {
+    return std::abs(a - b) <= tolerance;
+}
+
+TEST(timing_stats_mean_stddev) {
+    // population spread, four hits 10 ms either side of +5 ms
+    std::vector<double> errors = {-0.005, 0.015, -0.005, 0.015};
+    auto stats = hit_error_stats(errors);
+
+    CHECK(stats.count == 4);
+    CHECK(near(stats.mean, 0.005));
+    CHECK(near(stats.stddev, 0.010));
+    CHECK(near(stats.unstable_rate, 100));
+    CHECK(std::accumulate(stats.histogram.begin(), stats.histogram.end(), 0) == 4);
+    CHECK(stats.histogram_peak == 2);
+
+    auto one = hit_error_stats({0.003});
+    CHECK(one.count == 1);
+    CHECK(near(one.mean, 0.003));
+    CHECK(one.stddev == 0);
+
+    auto none = hit_error_stats({});
+    CHECK(none.count == 0);
+    CHECK(none.histogram_peak == 0);
+
+    return true;
+}
+
+TEST(timing_stats_histogram_clamp) {
+    // past the ok window both ways lands in the edge buckets instead of off the end
+    auto stats = hit_error_stats({-0.5, -0.0701, 0.0701, 0.5, 0.0});
+
+    CHECK(stats.histogram.front() == 2);
+    CHECK(stats.histogram.back() == 2);
+    CHECK(stats.histogram[hit_histogram_bins / 2] == 1);
+    CHECK(stats.histogram_peak == 2);
+
+    return true;
+}
+
+TEST(timing_stats_offset_rejects_outliers) {
+    // a tight cluster around +12 ms, a double hit and stray taps well past the ok window
+    std::vector<double> errors;
+    for (int i = 0; i < 20; i++) {
+        errors.push_back(0.012 + (i % 5 - 2) * 0.002);
+    }
+    errors.push_back(0.095);
+    errors.push_back(-0.150);
+    errors.push_back(0.300);
+
+    auto estimate = estimate_offset(errors);
+    CHECK(estimate.has_value());
+    CHECK(estimate->used == 20);
+    CHECK(estimate->rejected == 3);
+    CHECK(near(estimate->mean, 0.012));
+    CHECK(near(estimate->jitter, std::sqrt(0.000008), 1e-9));
+
+    // all hits the same, the millisecond floor keeps them all instead of rejecting on rounding
+    auto flat = estimate_offset(std::vector<double>(10, 0.02));
+    CHECK(flat.has_value());
+    CHECK(flat->used == 10);
+    CHECK(flat->rejected == 0);
+    CHECK(near(flat->mean, 0.02));
+
+    return true;
+}
+
+TEST(timing_stats_offset_needs_samples) {
+    CHECK(!estimate_offset({}).has_value());
+    CHECK(!estimate_offset(std::vector<double>(7, 0.01)).has_value());
+    CHECK(estimate_offset(std::vector<double>(8, 0.01)).has_value());
+
+    return true;
+}
+
+TEST(timing_stats_refine_offset) {
+    Settings settings{};
+    settings.global_offset = 0.010;
+    settings.offset_samples = 30;
+
+    // a play measured 10 hits still 4 ms late with the offset applied, weighted against the 30 before
+    refine_offset(settings, {0.004, 0.002, 10, 0});
+    CHECK(near(settings.global_offset, 0.011));
+    CHECK(settings.offset_samples == 40);
+
+    return true;
+}
@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numbers>
+
+#include "test.h"
+#include "waveform.h"
+
+constexpr int frequency = 44100;
+constexpr int channels = 2;
+
+// a sweep under a slow envelope so neighbouring blocks all have different peaks
+static std::shared_ptr<PcmTrack> sweep_track(double seconds) {
+    const int64_t frames = (int64_t)(seconds * frequency);
+    std::vector<float> samples(frames * channels);
+    for (int64_t i = 0; i < frames; i++) {
+        double time = (double)i / frequency;
+        float envelope = (float)(0.5 + 0.4 * std::sin(time * 0.7));
+        float sample = envelope * (float)std::sin(2 * std::numbers::pi * (200 + 20 * time) * time);
+        samples[i * channels] = sample;
+        samples[i * channels + 1] = -0.5f * sample;
+    }
+    return make_pcm(std::move(samples), channels, frequency);
+}
+
+TEST(waveform_peaks) {
+    auto track = sweep_track(10);
+    auto peaks = build_waveform(*track, "missing.ogg");
+
+    const size_t blocks = (track->samples.size() + peak_base_block * channels - 1) / (peak_base_block * channels);
+    CHECK(peaks->levels[0].mins.size() == blocks);
+    CHECK(peaks->levels.back().mins.size() == 1);
+    CHECK(peaks->levels.size() == (size_t)std::ceil(std::log2((double)blocks)) + 1);
+
+    // the top of the pyramid is the whole track
+    auto [lo, hi] = std::minmax_element(track->samples.begin(), track->samples.end());
+    CHECK(peaks->levels.back().mins[0] == *lo);
+    CHECK(peaks->levels.back().maxs[0] == *hi);
+
+    // every level is the pairwise fold of the one below, the odd block carried as is
+    for (size_t level = 1; level < peaks->levels.size(); level++) {
+        auto& below = peaks->levels[level - 1];
+        auto& above = peaks->levels[level];
+        for (size_t i = 0; i < above.mins.size(); i++) {
+            size_t right = std::min(2 * i + 1, below.mins.size() - 1);
+            CHECK(above.mins[i] == std::min(below.mins[2 * i], below.mins[right]));
+            CHECK(above.maxs[i] == std::max(below.maxs[2 * i], below.maxs[right]));
+        }
+    }
+
+    return true;
+}
+
+TEST(bench_waveform_5min) {
+    auto track = sweep_track(5 * 60);
+
+    // best of a few so a busy machine doesnt decide the number
+    double best_ms = 1e9;
+    size_t levels = 0;
+    for (int run = 0; run < 5; run++) {
+        auto start = std::chrono::steady_clock::now();
+        auto peaks = build_waveform(*track, "missing.ogg");
+        best_ms = std::min(best_ms, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        levels = peaks->levels.size();
+    }
+
+    std::printf("  waveform: 300 s stereo 44.1 kHz, %zu levels in %.2f ms\n", levels, best_ms);
+    CHECK(levels > 0);
+
+    return true;
+}